@@ -0,0 +1,250 @@
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Паттерн Строитель
+ *
+ * Назначение: Позволяет создавать сложные объекты пошагово. Строитель даёт
+ * возможность использовать один и тот же код строительства для получения разных
+ * представлений объектов.
+ *
+ * Этот вариант показывает, что делать, когда рецепты Директора известны ещё на
+ * этапе компиляции. Вместо трёх виртуальных вызовов через Builder* рецепт
+ * описывается списком типов, а шаблонный Директор разворачивает его в линейный
+ * код без виртуальной диспетчеризации. Количество частей известно заранее,
+ * поэтому память под них резервируется одним выделением.
+ */
+
+class Product1 {
+ public:
+  std::vector<std::string> parts_;
+
+  void ListParts() const {
+    std::cout << "Product parts: ";
+    for (std::size_t i = 0; i < parts_.size(); i++) {
+      if (i + 1 == parts_.size()) {
+        std::cout << parts_[i];
+      } else {
+        std::cout << parts_[i] << ", ";
+      }
+    }
+    std::cout << "\n\n";
+  }
+};
+
+/**
+ * Классический интерфейс Строителя и Директор из основного примера. Они нужны
+ * здесь только для сравнения.
+ */
+class Builder {
+ public:
+  virtual ~Builder() {}
+  virtual void ProducePartA() const = 0;
+  virtual void ProducePartB() const = 0;
+  virtual void ProducePartC() const = 0;
+};
+
+class ConcreteBuilder1 : public Builder {
+ private:
+  Product1 *product_;
+
+ public:
+  ConcreteBuilder1() {
+    this->Reset();
+  }
+  ~ConcreteBuilder1() {
+    delete product_;
+  }
+  void Reset() {
+    this->product_ = new Product1();
+  }
+  void ProducePartA() const override {
+    this->product_->parts_.push_back("PartA1");
+  }
+  void ProducePartB() const override {
+    this->product_->parts_.push_back("PartB1");
+  }
+  void ProducePartC() const override {
+    this->product_->parts_.push_back("PartC1");
+  }
+  Product1 *GetProduct() {
+    Product1 *result = this->product_;
+    this->Reset();
+    return result;
+  }
+};
+
+class Director {
+ private:
+  Builder *builder_;
+
+ public:
+  void set_builder(Builder *builder) {
+    this->builder_ = builder;
+  }
+  void BuildMinimalViableProduct() {
+    this->builder_->ProducePartA();
+  }
+  void BuildFullFeaturedProduct() {
+    this->builder_->ProducePartA();
+    this->builder_->ProducePartB();
+    this->builder_->ProducePartC();
+  }
+};
+
+/**
+ * Части продукта описываются типами. Имя и его длина известны при компиляции,
+ * поэтому строителю не нужно вычислять длину строки во время выполнения.
+ */
+struct PartA {
+  static const char *Name() {
+    return "PartA1";
+  }
+  static std::size_t Length() {
+    return 6;
+  }
+};
+
+struct PartB {
+  static const char *Name() {
+    return "PartB1";
+  }
+  static std::size_t Length() {
+    return 6;
+  }
+};
+
+struct PartC {
+  static const char *Name() {
+    return "PartC1";
+  }
+  static std::size_t Length() {
+    return 6;
+  }
+};
+
+/**
+ * Рецепт — это просто список шагов построения. Его длина доступна как
+ * константа времени компиляции.
+ */
+template <typename... Parts>
+struct Recipe {
+  static constexpr std::size_t kPartCount = sizeof...(Parts);
+};
+
+typedef Recipe<PartA> MinimalViableProduct;
+typedef Recipe<PartA, PartB, PartC> FullFeaturedProduct;
+typedef Recipe<PartA, PartC> CustomProduct;
+
+/**
+ * Статический Строитель не имеет виртуальных методов. Шаги построения — это
+ * шаблонные методы, которые компилятор может встроить в код Директора.
+ * Продукт хранится по значению и отдаётся клиенту перемещением, поэтому
+ * вопрос владения памятью здесь не возникает.
+ */
+class StaticBuilder1 {
+ private:
+  Product1 product_;
+
+ public:
+  void Reserve(std::size_t part_count) {
+    this->product_.parts_.reserve(part_count);
+  }
+
+  template <typename Part>
+  void Produce() {
+    this->product_.parts_.emplace_back(Part::Name(), Part::Length());
+  }
+
+  Product1 GetProduct() {
+    Product1 result(std::move(this->product_));
+    this->product_ = Product1();
+    return result;
+  }
+};
+
+/**
+ * Статический Директор разворачивает рецепт в последовательность вызовов
+ * Produce<Part>() на этапе компиляции. Для FullFeaturedProduct это ровно три
+ * встроенных шага и одно резервирование памяти под три части.
+ */
+template <typename R>
+class StaticDirector;
+
+template <typename... Parts>
+class StaticDirector<Recipe<Parts...> > {
+ public:
+  template <typename B>
+  static void Build(B &builder) {
+    builder.Reserve(Recipe<Parts...>::kPartCount);
+    int expand[] = {0, (builder.template Produce<Parts>(), 0)...};
+    (void)expand;
+  }
+};
+
+/**
+ * Клиентский код выбирает рецепт типом, а не вызовом метода Директора.
+ */
+void ClientCode() {
+  StaticBuilder1 builder;
+
+  std::cout << "Standard basic product:\n";
+  StaticDirector<MinimalViableProduct>::Build(builder);
+  builder.GetProduct().ListParts();
+
+  std::cout << "Standard full featured product:\n";
+  StaticDirector<FullFeaturedProduct>::Build(builder);
+  builder.GetProduct().ListParts();
+
+  std::cout << "Custom product:\n";
+  StaticDirector<CustomProduct>::Build(builder);
+  builder.GetProduct().ListParts();
+}
+
+/**
+ * Сравнение с классическим Директором: оба варианта строят один и тот же
+ * полнофункциональный продукт заданное количество раз.
+ */
+double NanosecondsPerProduct(std::chrono::steady_clock::duration elapsed, std::size_t count) {
+  return std::chrono::duration<double, std::nano>(elapsed).count() / count;
+}
+
+void Benchmark(std::size_t count) {
+  std::size_t checksum = 0;
+
+  ConcreteBuilder1 *builder = new ConcreteBuilder1();
+  Director director;
+  director.set_builder(builder);
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < count; i++) {
+    director.BuildFullFeaturedProduct();
+    Product1 *p = builder->GetProduct();
+    checksum += p->parts_.size();
+    delete p;
+  }
+  double runtime_ns = NanosecondsPerProduct(std::chrono::steady_clock::now() - start, count);
+  delete builder;
+
+  StaticBuilder1 static_builder;
+  start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < count; i++) {
+    StaticDirector<FullFeaturedProduct>::Build(static_builder);
+    Product1 p = static_builder.GetProduct();
+    checksum += p.parts_.size();
+  }
+  double static_ns = NanosecondsPerProduct(std::chrono::steady_clock::now() - start, count);
+
+  std::cout << "Benchmark: " << count << " full featured products (checksum " << checksum << ")\n";
+  std::cout << "Runtime Director:        " << runtime_ns << " ns/product\n";
+  std::cout << "Compile-time Director:   " << static_ns << " ns/product\n";
+}
+
+int main() {
+  ClientCode();
+  Benchmark(1000000);
+  return 0;
+}
@@ -0,0 +1,350 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Паттерн Строитель
+ *
+ * Назначение: Позволяет создавать сложные объекты пошагово. Строитель даёт
+ * возможность использовать один и тот же код строительства для получения разных
+ * представлений объектов.
+ *
+ * В этом варианте продукт не хранит копии строк "PartA1", "PartB1" и т.д.
+ * Имена частей интернируются один раз, а продукт хранит только их небольшие
+ * целочисленные идентификаторы во встроенном буфере. Перечисление частей
+ * выполняется за один проход и пишет результат в произвольный приёмник.
+ */
+
+/**
+ * Таблица интернированных имён частей. Каждое имя хранится ровно один раз,
+ * продукты ссылаются на него по индексу.
+ */
+typedef std::uint16_t PartId;
+
+class PartNames {
+ private:
+  std::unordered_map<std::string, PartId> ids_;
+  std::vector<std::string> names_;
+
+ public:
+  PartId Intern(const std::string &name) {
+    std::unordered_map<std::string, PartId>::const_iterator it = ids_.find(name);
+    if (it != ids_.end()) {
+      return it->second;
+    }
+    PartId id = static_cast<PartId>(names_.size());
+    names_.push_back(name);
+    ids_[name] = id;
+    return id;
+  }
+
+  const std::string &Name(PartId id) const {
+    return names_[id];
+  }
+
+  static PartNames &Instance() {
+    static PartNames names;
+    return names;
+  }
+};
+
+/**
+ * Приёмники вывода. Форматирование продукта работает с любым типом, у
+ * которого есть метод Append(const char*, size_t).
+ */
+class StreamSink {
+ private:
+  std::ostream &out_;
+
+ public:
+  explicit StreamSink(std::ostream &out) : out_(out) {
+  }
+  void Append(const char *data, std::size_t size) {
+    out_.write(data, size);
+  }
+};
+
+class StringSink {
+ private:
+  std::string *out_;
+
+ public:
+  explicit StringSink(std::string *out) : out_(out) {
+  }
+  void Append(const char *data, std::size_t size) {
+    out_->append(data, size);
+  }
+};
+
+/**
+ * Продукт хранит до kInlineParts идентификаторов прямо в себе. Только если
+ * частей больше, идентификаторы переносятся в кучу. Размер и ёмкость
+ * занимают по 16 бит, чтобы продукт оставался маленьким, поэтому частей
+ * может быть не больше kMaxParts.
+ */
+class Product1 {
+ public:
+  static const std::size_t kInlineParts = 6;
+  static const std::size_t kMaxParts = 0xFFFF;
+
+ private:
+  PartId *parts_;
+  std::uint16_t size_;
+  std::uint16_t capacity_;
+  PartId inline_parts_[kInlineParts];
+
+  bool is_inline() const {
+    return parts_ == inline_parts_;
+  }
+
+  void Grow() {
+    std::uint16_t capacity = static_cast<std::uint16_t>(std::min<std::size_t>(capacity_ * 2, kMaxParts));
+    PartId *parts = new PartId[capacity];
+    std::memcpy(parts, parts_, size_ * sizeof(PartId));
+    if (!is_inline()) {
+      delete[] parts_;
+    }
+    parts_ = parts;
+    capacity_ = capacity;
+  }
+
+ public:
+  Product1() : parts_(inline_parts_), size_(0), capacity_(kInlineParts) {
+  }
+
+  Product1(const Product1 &other) : parts_(inline_parts_), size_(0), capacity_(kInlineParts) {
+    for (std::size_t i = 0; i < other.size_; i++) {
+      Add(other.parts_[i]);
+    }
+  }
+
+  Product1 &operator=(const Product1 &other) {
+    if (this != &other) {
+      size_ = 0;
+      for (std::size_t i = 0; i < other.size_; i++) {
+        Add(other.parts_[i]);
+      }
+    }
+    return *this;
+  }
+
+  ~Product1() {
+    if (!is_inline()) {
+      delete[] parts_;
+    }
+  }
+
+  void Add(PartId part) {
+    if (size_ == kMaxParts) {
+      throw std::length_error("Product1: too many parts");
+    }
+    if (size_ == capacity_) {
+      Grow();
+    }
+    parts_[size_++] = part;
+  }
+
+  std::size_t size() const {
+    return size_;
+  }
+
+  std::size_t heap_bytes() const {
+    return is_inline() ? 0 : capacity_ * sizeof(PartId);
+  }
+
+  /**
+   * Один проход по идентификаторам: разделитель пишется перед каждой частью,
+   * кроме первой, поэтому повторяющиеся части выводятся корректно.
+   */
+  template <typename Sink>
+  void FormatParts(Sink &sink) const {
+    const PartNames &names = PartNames::Instance();
+    for (std::size_t i = 0; i < size_; i++) {
+      if (i != 0) {
+        sink.Append(", ", 2);
+      }
+      const std::string &name = names.Name(parts_[i]);
+      sink.Append(name.data(), name.size());
+    }
+  }
+
+  void ListParts() const {
+    StreamSink sink(std::cout);
+    sink.Append("Product parts: ", 15);
+    FormatParts(sink);
+    sink.Append("\n\n", 2);
+  }
+};
+
+/**
+ * Для сравнения: продукт из основного примера.
+ */
+class VectorProduct1 {
+ public:
+  std::vector<std::string> parts_;
+
+  std::size_t heap_bytes() const {
+    std::size_t bytes = parts_.capacity() * sizeof(std::string);
+    for (std::size_t i = 0; i < parts_.size(); i++) {
+      // Короткие строки хранятся внутри std::string (small string optimization).
+      if (parts_[i].capacity() > 15) {
+        bytes += parts_[i].capacity() + 1;
+      }
+    }
+    return bytes;
+  }
+};
+
+class Builder {
+ public:
+  virtual ~Builder() {}
+  virtual void ProducePartA() const = 0;
+  virtual void ProducePartB() const = 0;
+  virtual void ProducePartC() const = 0;
+};
+
+/**
+ * Строитель интернирует имена своих частей один раз, в конструкторе. Шаги
+ * построения добавляют в продукт только готовые идентификаторы.
+ */
+class ConcreteBuilder1 : public Builder {
+ private:
+  Product1 *product_;
+  PartId part_a_;
+  PartId part_b_;
+  PartId part_c_;
+
+ public:
+  ConcreteBuilder1()
+      : part_a_(PartNames::Instance().Intern("PartA1")),
+        part_b_(PartNames::Instance().Intern("PartB1")),
+        part_c_(PartNames::Instance().Intern("PartC1")) {
+    this->Reset();
+  }
+  ~ConcreteBuilder1() {
+    delete product_;
+  }
+  void Reset() {
+    this->product_ = new Product1();
+  }
+  void ProducePartA() const override {
+    this->product_->Add(part_a_);
+  }
+  void ProducePartB() const override {
+    this->product_->Add(part_b_);
+  }
+  void ProducePartC() const override {
+    this->product_->Add(part_c_);
+  }
+
+  /**
+   * Please be careful here with the memory ownership. Once you call
+   * GetProduct the user of this function is responsable to release this
+   * memory.
+   */
+  Product1 *GetProduct() {
+    Product1 *result = this->product_;
+    this->Reset();
+    return result;
+  }
+};
+
+class Director {
+ private:
+  Builder *builder_;
+
+ public:
+  void set_builder(Builder *builder) {
+    this->builder_ = builder;
+  }
+  void BuildMinimalViableProduct() {
+    this->builder_->ProducePartA();
+  }
+  void BuildFullFeaturedProduct() {
+    this->builder_->ProducePartA();
+    this->builder_->ProducePartB();
+    this->builder_->ProducePartC();
+  }
+};
+
+void ClientCode(Director &director) {
+  ConcreteBuilder1 *builder = new ConcreteBuilder1();
+  director.set_builder(builder);
+  std::cout << "Standard basic product:\n";
+  director.BuildMinimalViableProduct();
+
+  Product1 *p = builder->GetProduct();
+  p->ListParts();
+  delete p;
+
+  std::cout << "Standard full featured product:\n";
+  director.BuildFullFeaturedProduct();
+
+  p = builder->GetProduct();
+  p->ListParts();
+  delete p;
+
+  // Повторяющиеся части больше не ломают форматирование.
+  std::cout << "Custom product:\n";
+  builder->ProducePartA();
+  builder->ProducePartC();
+  builder->ProducePartA();
+  p = builder->GetProduct();
+  p->ListParts();
+
+  std::string text;
+  StringSink sink(&text);
+  p->FormatParts(sink);
+  std::cout << "Formatted into a string: \"" << text << "\"\n\n";
+  delete p;
+
+  delete builder;
+}
+
+/**
+ * Память на один полнофункциональный продукт при хранении миллиона продуктов
+ * в массиве: размер самого объекта плюс всё, что он держит в куче.
+ */
+void ReportMemory(std::size_t count) {
+  std::vector<VectorProduct1> vector_products(count);
+  std::size_t vector_heap = 0;
+  for (std::size_t i = 0; i < count; i++) {
+    vector_products[i].parts_.push_back("PartA1");
+    vector_products[i].parts_.push_back("PartB1");
+    vector_products[i].parts_.push_back("PartC1");
+    vector_heap += vector_products[i].heap_bytes();
+  }
+
+  PartNames &names = PartNames::Instance();
+  PartId a = names.Intern("PartA1");
+  PartId b = names.Intern("PartB1");
+  PartId c = names.Intern("PartC1");
+  std::vector<Product1> products(count);
+  std::size_t interned_heap = 0;
+  for (std::size_t i = 0; i < count; i++) {
+    products[i].Add(a);
+    products[i].Add(b);
+    products[i].Add(c);
+    interned_heap += products[i].heap_bytes();
+  }
+
+  std::cout << "Memory for " << count << " full featured products:\n";
+  std::cout << "std::vector<std::string>: " << sizeof(VectorProduct1) + vector_heap / count
+            << " bytes/product (" << sizeof(VectorProduct1) << " inline + " << vector_heap / count << " heap)\n";
+  std::cout << "Interned inline ids:      " << sizeof(Product1) + interned_heap / count << " bytes/product ("
+            << sizeof(Product1) << " inline + " << interned_heap / count << " heap)\n";
+}
+
+int main() {
+  Director *director = new Director();
+  ClientCode(*director);
+  delete director;
+  ReportMemory(1000000);
+  return 0;
+}
@@ -0,0 +1,233 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * Паттерн Строитель
+ *
+ * Назначение: Позволяет создавать сложные объекты пошагово. Строитель даёт
+ * возможность использовать один и тот же код строительства для получения разных
+ * представлений объектов.
+ *
+ * Строитель хранит изменяемое состояние (продукт, который сейчас собирается),
+ * поэтому одну пару Директор/Строитель нельзя использовать из нескольких
+ * потоков. Этот вариант показывает пакетное построение: у каждого рабочего
+ * потока свой Директор и свой Строитель, а готовые продукты перемещаются в
+ * заранее выделенный выходной массив, каждый поток — в свой диапазон.
+ */
+
+class Product1 {
+ public:
+  std::vector<std::string> parts_;
+
+  void ListParts() const {
+    std::cout << "Product parts: ";
+    for (std::size_t i = 0; i < parts_.size(); i++) {
+      if (i + 1 == parts_.size()) {
+        std::cout << parts_[i];
+      } else {
+        std::cout << parts_[i] << ", ";
+      }
+    }
+    std::cout << "\n\n";
+  }
+};
+
+class Builder {
+ public:
+  virtual ~Builder() {}
+  virtual void ProducePartA() = 0;
+  virtual void ProducePartB() = 0;
+  virtual void ProducePartC() = 0;
+};
+
+/**
+ * Продукт хранится в строителе по значению. TakeProduct отдаёт его
+ * перемещением, поэтому перенос в выходной массив не копирует части.
+ */
+class ConcreteBuilder1 : public Builder {
+ private:
+  Product1 product_;
+
+ public:
+  void ProducePartA() override {
+    this->product_.parts_.push_back("PartA1");
+  }
+  void ProducePartB() override {
+    this->product_.parts_.push_back("PartB1");
+  }
+  void ProducePartC() override {
+    this->product_.parts_.push_back("PartC1");
+  }
+  Product1 TakeProduct() {
+    Product1 result(std::move(this->product_));
+    this->product_ = Product1();
+    return result;
+  }
+};
+
+class Director {
+ private:
+  Builder *builder_;
+
+ public:
+  Director() : builder_(nullptr) {
+  }
+  void set_builder(Builder *builder) {
+    this->builder_ = builder;
+  }
+  void BuildMinimalViableProduct() {
+    this->builder_->ProducePartA();
+  }
+  void BuildFullFeaturedProduct() {
+    this->builder_->ProducePartA();
+    this->builder_->ProducePartB();
+    this->builder_->ProducePartC();
+  }
+};
+
+/**
+ * Рецепт — это любой метод Директора, который выполняет шаги построения.
+ */
+typedef void (Director::*Recipe)();
+
+/**
+ * Пакетный Директор делит выходной массив на непрерывные диапазоны по числу
+ * потоков. Каждый поток создаёт собственные Директор и Строитель, поэтому
+ * потоки не разделяют никакого изменяемого состояния, кроме своих участков
+ * выходного массива.
+ */
+template <typename ConcreteBuilder>
+class BatchDirector {
+ private:
+  unsigned thread_count_;
+
+  static void BuildRange(Recipe recipe, Product1 *out, std::size_t begin, std::size_t end) {
+    ConcreteBuilder builder;
+    Director director;
+    director.set_builder(&builder);
+    for (std::size_t i = begin; i < end; i++) {
+      (director.*recipe)();
+      out[i] = builder.TakeProduct();
+    }
+  }
+
+ public:
+  explicit BatchDirector(unsigned thread_count) : thread_count_(thread_count == 0 ? 1 : thread_count) {
+  }
+
+  /**
+   * Строит count продуктов в уже выделенный массив out. Исключение из
+   * любого потока передаётся вызывающему, но только после того, как все
+   * рабочие потоки завершились; если исключений несколько, бросается
+   * первое по номеру диапазона.
+   */
+  void Build(Recipe recipe, Product1 *out, std::size_t count) const {
+    std::vector<std::thread> workers;
+    std::vector<std::exception_ptr> errors(thread_count_);
+    std::size_t chunk = (count + thread_count_ - 1) / thread_count_;
+    // Место под потоки резервируется заранее: push_back не должен бросать,
+    // когда поток уже запущен. Если не удалось запустить очередной поток,
+    // уже запущенные дожидаются, иначе их разрушение вызвало бы
+    // std::terminate.
+    workers.reserve(thread_count_);
+    try {
+      for (unsigned t = 1; t < thread_count_; t++) {
+        std::size_t begin = t * chunk < count ? t * chunk : count;
+        std::size_t end = begin + chunk < count ? begin + chunk : count;
+        std::exception_ptr *error = &errors[t];
+        workers.push_back(std::thread([recipe, out, begin, end, error] {
+          try {
+            BuildRange(recipe, out, begin, end);
+          } catch (...) {
+            *error = std::current_exception();
+          }
+        }));
+      }
+    } catch (...) {
+      for (std::size_t i = 0; i < workers.size(); i++) {
+        workers[i].join();
+      }
+      throw;
+    }
+    // Первый диапазон строит вызывающий поток.
+    try {
+      BuildRange(recipe, out, 0, chunk < count ? chunk : count);
+    } catch (...) {
+      errors[0] = std::current_exception();
+    }
+    for (std::size_t i = 0; i < workers.size(); i++) {
+      workers[i].join();
+    }
+    for (std::size_t i = 0; i < errors.size(); i++) {
+      if (errors[i]) {
+        std::rethrow_exception(errors[i]);
+      }
+    }
+  }
+
+  void Build(Recipe recipe, std::vector<Product1> *out, std::size_t count) const {
+    out->resize(count);
+    Build(recipe, out->data(), count);
+  }
+};
+
+void ClientCode() {
+  BatchDirector<ConcreteBuilder1> batch(2);
+  std::vector<Product1> products;
+
+  std::cout << "Batch of standard basic products:\n";
+  batch.Build(&Director::BuildMinimalViableProduct, &products, 3);
+  for (std::size_t i = 0; i < products.size(); i++) {
+    products[i].ListParts();
+  }
+
+  std::cout << "Batch of standard full featured products:\n";
+  batch.Build(&Director::BuildFullFeaturedProduct, &products, 3);
+  for (std::size_t i = 0; i < products.size(); i++) {
+    products[i].ListParts();
+  }
+}
+
+/**
+ * Пропускная способность в зависимости от числа потоков. Перед каждым
+ * замером выходной массив заменяется пустым вне измеряемого участка, чтобы
+ * замер не включал разрушение продуктов предыдущего.
+ */
+void Benchmark(std::size_t count) {
+  unsigned hardware_threads = std::thread::hardware_concurrency();
+  if (hardware_threads == 0) {
+    hardware_threads = 1;
+  }
+  std::vector<unsigned> thread_counts;
+  for (unsigned t = 1; t < hardware_threads; t *= 2) {
+    thread_counts.push_back(t);
+  }
+  thread_counts.push_back(hardware_threads);
+
+  std::vector<Product1> products(count);
+  std::cout << "Benchmark: " << count << " full featured products, " << hardware_threads << " hardware threads\n";
+  for (std::size_t i = 0; i < thread_counts.size(); i++) {
+    BatchDirector<ConcreteBuilder1> batch(thread_counts[i]);
+    std::vector<Product1>(count).swap(products);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    batch.Build(&Director::BuildFullFeaturedProduct, products.data(), count);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double per_second = count / seconds;
+    std::cout << thread_counts[i] << " thread(s): " << per_second / 1e6 << " M products/s, "
+              << per_second / thread_counts[i] / 1e6 << " M products/s per thread\n";
+  }
+}
+
+int main(int argc, char *argv[]) {
+  ClientCode();
+  std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000000;
+  Benchmark(count);
+  return 0;
+}
@@ -25,7 +25,7 @@ class Product1{
     void ListParts()const{
         std::cout << "Product parts: ";
         for (size_t i=0;i<parts_.size();i++){
-            if(parts_[i]== parts_.back()){
+            if(i+1==parts_.size()){
                 std::cout << parts_[i];
             }else{
                 std::cout << parts_[i] << ", ";
@@ -0,0 +1,420 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <future>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * Паттерн Команда
+ *
+ * Назначение: Превращает запросы в объекты, позволяя передавать их как
+ * аргументы при вызове методов, ставить запросы в очередь, логировать их, а
+ * также поддерживать отмену операций.
+ *
+ * Этот вариант показывает «шину команд»: команды ставятся в общую очередь со
+ * многими производителями и многими потребителями, а выполняет их
+ * фиксированный пул рабочих потоков. Рабочие забирают команды из очереди
+ * пачками, отправитель получает std::future на результат, а шина собирает
+ * гистограммы времени ожидания в очереди и времени выполнения команд.
+ */
+/**
+ * Интерфейс Команды объявляет метод для выполнения команд.
+ */
+class Command {
+ public:
+  virtual ~Command() {
+  }
+  virtual void Execute() const = 0;
+};
+
+class SimpleCommand : public Command {
+ private:
+  std::string pay_load_;
+
+ public:
+  explicit SimpleCommand(std::string pay_load) : pay_load_(std::move(pay_load)) {
+  }
+  void Execute() const override {
+    std::cout << "SimpleCommand: See, I can do simple things like printing (" << this->pay_load_ << ")\n";
+  }
+};
+
+/**
+ * Теперь Получателя могут вызывать несколько рабочих потоков одновременно.
+ * Операции не печатают сами, а дописывают строки в out; Print выводит
+ * накопленный текст одним вызовом под мьютексом. Так строки одной команды
+ * не перемешиваются со строками других, а сами команды выполняются
+ * параллельно.
+ */
+class Receiver {
+ private:
+  std::mutex mutex_;
+
+ public:
+  void DoSomething(const std::string &a, std::string *out) {
+    out->append("Receiver: Working on (" + a + ".)\n");
+  }
+  void DoSomethingElse(const std::string &b, std::string *out) {
+    out->append("Receiver: Also working on (" + b + ".)\n");
+  }
+  void Print(const std::string &text) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::cout << text;
+  }
+};
+
+class ComplexCommand : public Command {
+ private:
+  Receiver *receiver_;
+  std::string a_;
+  std::string b_;
+
+ public:
+  ComplexCommand(Receiver *receiver, std::string a, std::string b)
+      : receiver_(receiver), a_(std::move(a)), b_(std::move(b)) {
+  }
+  void Execute() const override {
+    std::string out = "ComplexCommand: Complex stuff should be done by a receiver object.\n";
+    this->receiver_->DoSomething(this->a_, &out);
+    this->receiver_->DoSomethingElse(this->b_, &out);
+    this->receiver_->Print(out);
+  }
+};
+
+/**
+ * Гистограмма задержек с корзинами по степеням двойки (в наносекундах).
+ * Запись — одна атомарная операция, поэтому рабочие потоки не мешают друг
+ * другу. Перцентили оцениваются по верхней границе корзины.
+ */
+class LatencyHistogram {
+ public:
+  static const int kBuckets = 48;
+
+ private:
+  std::atomic<std::uint64_t> buckets_[kBuckets];
+  std::atomic<std::uint64_t> count_;
+  std::atomic<std::uint64_t> total_ns_;
+
+ public:
+  LatencyHistogram() : count_(0), total_ns_(0) {
+    for (int i = 0; i < kBuckets; i++) {
+      buckets_[i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  void Record(std::chrono::steady_clock::duration latency) {
+    std::uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count();
+    int bucket = 0;
+    while (bucket + 1 < kBuckets && (std::uint64_t(1) << (bucket + 1)) <= ns) {
+      bucket++;
+    }
+    buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    total_ns_.fetch_add(ns, std::memory_order_relaxed);
+  }
+
+  std::uint64_t count() const {
+    return count_.load(std::memory_order_relaxed);
+  }
+
+  double MeanNs() const {
+    std::uint64_t n = count();
+    return n == 0 ? 0.0 : double(total_ns_.load(std::memory_order_relaxed)) / n;
+  }
+
+  std::uint64_t PercentileNs(double percentile) const {
+    std::uint64_t n = count();
+    std::uint64_t target = std::uint64_t(n * percentile);
+    std::uint64_t seen = 0;
+    for (int i = 0; i < kBuckets; i++) {
+      seen += buckets_[i].load(std::memory_order_relaxed);
+      if (seen > target) {
+        return std::uint64_t(1) << (i + 1);
+      }
+    }
+    return std::uint64_t(1) << kBuckets;
+  }
+
+  void Print(const char *name) const {
+    std::cout << name << ": count=" << count() << " mean=" << MeanNs() << "ns p50<=" << PercentileNs(0.50)
+              << "ns p99<=" << PercentileNs(0.99) << "ns\n";
+  }
+};
+
+/**
+ * Элемент очереди: команда, обещание для отправителя и момент постановки в
+ * очередь.
+ */
+struct QueuedCommand {
+  Command *command;
+  std::promise<void> done;
+  std::chrono::steady_clock::time_point enqueued;
+};
+
+/**
+ * Ограниченная очередь со многими производителями и потребителями. Push
+ * блокируется, если очередь заполнена; PopBatch забирает за одну блокировку
+ * до max_batch команд.
+ */
+class CommandQueue {
+ private:
+  std::mutex mutex_;
+  std::condition_variable not_empty_;
+  std::condition_variable not_full_;
+  std::deque<QueuedCommand> items_;
+  std::size_t capacity_;
+  bool closed_;
+
+ public:
+  explicit CommandQueue(std::size_t capacity) : capacity_(capacity), closed_(false) {
+  }
+
+  bool Push(QueuedCommand &&item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_full_.wait(lock, [this] { return closed_ || items_.size() < capacity_; });
+    if (closed_) {
+      return false;
+    }
+    items_.push_back(std::move(item));
+    lock.unlock();
+    not_empty_.notify_one();
+    return true;
+  }
+
+  /**
+   * Возвращает false, только когда очередь закрыта и пуста.
+   */
+  bool PopBatch(std::vector<QueuedCommand> *batch, std::size_t max_batch) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_empty_.wait(lock, [this] { return closed_ || !items_.empty(); });
+    if (items_.empty()) {
+      return false;
+    }
+    while (!items_.empty() && batch->size() < max_batch) {
+      batch->push_back(std::move(items_.front()));
+      items_.pop_front();
+    }
+    lock.unlock();
+    not_full_.notify_all();
+    return true;
+  }
+
+  void Close() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      closed_ = true;
+    }
+    not_empty_.notify_all();
+    not_full_.notify_all();
+  }
+};
+
+/**
+ * Шина команд владеет пулом рабочих потоков. Submit передаёт шине владение
+ * командой и возвращает future, который станет готов после выполнения.
+ * Исключение, выброшенное командой, передаётся через этот future.
+ */
+class CommandBus {
+ private:
+  CommandQueue queue_;
+  std::size_t max_batch_;
+  std::vector<std::thread> workers_;
+  LatencyHistogram queue_wait_;
+  LatencyHistogram execution_;
+
+  void WorkerLoop() {
+    std::vector<QueuedCommand> batch;
+    batch.reserve(max_batch_);
+    while (queue_.PopBatch(&batch, max_batch_)) {
+      for (std::size_t i = 0; i < batch.size(); i++) {
+        QueuedCommand &item = batch[i];
+        std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+        queue_wait_.Record(started - item.enqueued);
+        try {
+          item.command->Execute();
+          item.done.set_value();
+        } catch (...) {
+          item.done.set_exception(std::current_exception());
+        }
+        execution_.Record(std::chrono::steady_clock::now() - started);
+        delete item.command;
+      }
+      batch.clear();
+    }
+  }
+
+ public:
+  CommandBus(unsigned worker_count, std::size_t queue_capacity = 1024, std::size_t max_batch = 32)
+      : queue_(queue_capacity), max_batch_(max_batch) {
+    for (unsigned i = 0; i < worker_count; i++) {
+      workers_.push_back(std::thread(&CommandBus::WorkerLoop, this));
+    }
+  }
+
+  ~CommandBus() {
+    Shutdown();
+  }
+
+  /**
+   * Закрывает очередь и дожидается выполнения всех команд, уже поставленных в
+   * неё. После этого Submit больше не принимает команды.
+   */
+  void Shutdown() {
+    queue_.Close();
+    for (std::size_t i = 0; i < workers_.size(); i++) {
+      workers_[i].join();
+    }
+    workers_.clear();
+  }
+
+  /**
+   * После Shutdown команда не выполняется, а возвращённый future сразу
+   * содержит std::logic_error.
+   */
+  std::future<void> Submit(Command *command) {
+    QueuedCommand item;
+    item.command = command;
+    item.enqueued = std::chrono::steady_clock::now();
+    std::future<void> result = item.done.get_future();
+    if (!queue_.Push(std::move(item))) {
+      delete command;
+      item.done.set_exception(std::make_exception_ptr(std::logic_error("CommandBus: Submit after Shutdown")));
+    }
+    return result;
+  }
+
+  const LatencyHistogram &queue_wait() const {
+    return queue_wait_;
+  }
+  const LatencyHistogram &execution() const {
+    return execution_;
+  }
+};
+
+/**
+ * Отправитель больше не выполняет команды сам, а передаёт их шине и
+ * дожидается результата, сохраняя порядок «до» и «после».
+ */
+class Invoker {
+ private:
+  CommandBus *bus_;
+  Command *on_start_;
+  Command *on_finish_;
+
+ public:
+  explicit Invoker(CommandBus *bus) : bus_(bus), on_start_(nullptr), on_finish_(nullptr) {
+  }
+  ~Invoker() {
+    delete on_start_;
+    delete on_finish_;
+  }
+  void SetOnStart(Command *command) {
+    this->on_start_ = command;
+  }
+  void SetOnFinish(Command *command) {
+    this->on_finish_ = command;
+  }
+  void DoSomethingImportant() {
+    std::cout << "Invoker: Does anybody want something done before I begin?\n";
+    if (this->on_start_) {
+      Command *command = this->on_start_;
+      this->on_start_ = nullptr;
+      this->bus_->Submit(command).get();
+    }
+    std::cout << "Invoker: ...doing something really important...\n";
+    std::cout << "Invoker: Does anybody want something done after I finish?\n";
+    if (this->on_finish_) {
+      Command *command = this->on_finish_;
+      this->on_finish_ = nullptr;
+      this->bus_->Submit(command).get();
+    }
+  }
+};
+
+/**
+ * Дешёвая команда для замеров: только увеличивает счётчик.
+ */
+class CountCommand : public Command {
+ private:
+  std::atomic<std::uint64_t> *counter_;
+
+ public:
+  explicit CountCommand(std::atomic<std::uint64_t> *counter) : counter_(counter) {
+  }
+  void Execute() const override {
+    counter_->fetch_add(1, std::memory_order_relaxed);
+  }
+};
+
+void ClientCode() {
+  CommandBus bus(4);
+  Receiver *receiver = new Receiver;
+
+  Invoker *invoker = new Invoker(&bus);
+  invoker->SetOnStart(new SimpleCommand("Say Hi!"));
+  invoker->SetOnFinish(new ComplexCommand(receiver, "Send email", "Save report"));
+  invoker->DoSomethingImportant();
+  delete invoker;
+
+  // Несколько сложных команд выполняются параллельно, порядок команд может
+  // отличаться от запуска к запуску, но строки одной команды идут подряд.
+  std::cout << "\nClient: submitting three complex commands at once.\n";
+  std::vector<std::future<void> > results;
+  results.push_back(bus.Submit(new ComplexCommand(receiver, "Send email 1", "Save report 1")));
+  results.push_back(bus.Submit(new ComplexCommand(receiver, "Send email 2", "Save report 2")));
+  results.push_back(bus.Submit(new ComplexCommand(receiver, "Send email 3", "Save report 3")));
+  for (std::size_t i = 0; i < results.size(); i++) {
+    results[i].get();
+  }
+  std::cout << "Client: all complex commands are done.\n";
+
+  bus.Shutdown();
+  try {
+    bus.Submit(new SimpleCommand("Too late")).get();
+  } catch (const std::logic_error &e) {
+    std::cout << "Client: " << e.what() << "\n";
+  }
+  std::cout << "\n";
+  delete receiver;
+}
+
+void Benchmark(unsigned worker_count, unsigned producer_count, std::size_t commands_per_producer) {
+  std::atomic<std::uint64_t> counter(0);
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  {
+    CommandBus bus(worker_count, 4096, 64);
+    std::vector<std::thread> producers;
+    for (unsigned p = 0; p < producer_count; p++) {
+      producers.push_back(std::thread([&bus, &counter, commands_per_producer] {
+        for (std::size_t i = 0; i < commands_per_producer; i++) {
+          bus.Submit(new CountCommand(&counter));
+        }
+      }));
+    }
+    for (std::size_t i = 0; i < producers.size(); i++) {
+      producers[i].join();
+    }
+    bus.Shutdown();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Benchmark: " << counter.load() << " commands, " << producer_count << " producers, "
+              << worker_count << " workers: " << counter.load() / seconds / 1e6 << " M commands/s\n";
+    bus.queue_wait().Print("Queue wait");
+    bus.execution().Print("Execution ");
+  }
+}
+
+int main() {
+  ClientCode();
+  Benchmark(4, 4, 250000);
+  return 0;
+}
@@ -0,0 +1,384 @@
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * Паттерн Команда
+ *
+ * Назначение: Превращает запросы в объекты, позволяя передавать их как
+ * аргументы при вызове методов, ставить запросы в очередь, логировать их, а
+ * также поддерживать отмену операций.
+ *
+ * Этот вариант показывает асинхронные команды на сопрограммах C++20. Метод
+ * Execute асинхронной команды — это сопрограмма: пока команда ждёт ввода-
+ * вывода («отправка письма», «сохранение отчёта»), она приостанавливается и
+ * не занимает поток. Команды выполняет цикл событий, который может работать
+ * как в одном, так и в нескольких потоках.
+ *
+ * В отличие от остальных примеров, этот требует C++20: g++ -std=c++20.
+ */
+
+class EventLoop;
+
+/**
+ * Задача-сопрограмма. Запускается лениво: либо когда её ожидает другая
+ * сопрограмма через co_await, либо когда её передают циклу событий через
+ * EventLoop::Spawn. Во втором случае задача освобождает себя сама по
+ * завершении.
+ */
+class Task {
+ public:
+  struct promise_type {
+    std::coroutine_handle<> continuation;
+    EventLoop *loop = nullptr;
+    std::exception_ptr error;
+
+    Task get_return_object() {
+      return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+    std::suspend_always initial_suspend() noexcept {
+      return {};
+    }
+
+    struct FinalAwaiter {
+      bool await_ready() noexcept {
+        return false;
+      }
+      std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept;
+      void await_resume() noexcept {
+      }
+    };
+
+    FinalAwaiter final_suspend() noexcept {
+      return {};
+    }
+    void return_void() {
+    }
+    void unhandled_exception() {
+      error = std::current_exception();
+    }
+  };
+
+  explicit Task(std::coroutine_handle<promise_type> handle) : handle_(handle) {
+  }
+  Task(Task &&other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {
+  }
+  Task(const Task &) = delete;
+  Task &operator=(const Task &) = delete;
+  ~Task() {
+    if (handle_) {
+      handle_.destroy();
+    }
+  }
+
+  bool await_ready() const noexcept {
+    return false;
+  }
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+    handle_.promise().continuation = awaiting;
+    return handle_;
+  }
+  void await_resume() {
+    if (handle_.promise().error) {
+      std::rethrow_exception(handle_.promise().error);
+    }
+  }
+
+  std::coroutine_handle<promise_type> Release() {
+    return std::exchange(handle_, nullptr);
+  }
+
+ private:
+  std::coroutine_handle<promise_type> handle_;
+};
+
+/**
+ * Цикл событий: очередь готовых к продолжению сопрограмм и таймеры.
+ * Run возвращает управление, когда все запущенные через Spawn задачи
+ * завершились.
+ */
+class EventLoop {
+ public:
+  typedef std::chrono::steady_clock Clock;
+
+ private:
+  struct Timer {
+    Clock::time_point when;
+    std::coroutine_handle<> handle;
+    bool operator>(const Timer &other) const {
+      return when > other.when;
+    }
+  };
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::deque<std::coroutine_handle<> > ready_;
+  std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer> > timers_;
+  std::size_t in_flight_ = 0;
+
+  void WorkerLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+      if (in_flight_ == 0) {
+        wake_.notify_all();
+        return;
+      }
+      Clock::time_point now = Clock::now();
+      while (!timers_.empty() && timers_.top().when <= now) {
+        ready_.push_back(timers_.top().handle);
+        timers_.pop();
+      }
+      if (!ready_.empty()) {
+        std::coroutine_handle<> handle = ready_.front();
+        ready_.pop_front();
+        lock.unlock();
+        handle.resume();
+        lock.lock();
+        continue;
+      }
+      if (timers_.empty()) {
+        wake_.wait(lock);
+      } else {
+        wake_.wait_until(lock, timers_.top().when);
+      }
+    }
+  }
+
+ public:
+  void Spawn(Task task) {
+    std::coroutine_handle<Task::promise_type> handle = task.Release();
+    handle.promise().loop = this;
+    std::lock_guard<std::mutex> lock(mutex_);
+    in_flight_++;
+    ready_.push_back(handle);
+    wake_.notify_one();
+  }
+
+  void ScheduleAt(Clock::time_point when, std::coroutine_handle<> handle) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    timers_.push(Timer{when, handle});
+    wake_.notify_one();
+  }
+
+  void OnTaskDone() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--in_flight_ == 0) {
+      wake_.notify_all();
+    }
+  }
+
+  void Run(unsigned thread_count = 1) {
+    std::vector<std::thread> helpers;
+    for (unsigned i = 1; i < thread_count; i++) {
+      helpers.emplace_back(&EventLoop::WorkerLoop, this);
+    }
+    WorkerLoop();
+    for (std::thread &helper : helpers) {
+      helper.join();
+    }
+  }
+
+  /**
+   * Ожидание, которое не блокирует поток: сопрограмма приостанавливается, а
+   * цикл возобновит её по таймеру. Так в примере имитируется ввод-вывод.
+   */
+  struct SleepAwaiter {
+    EventLoop *loop;
+    Clock::duration duration;
+    bool await_ready() const noexcept {
+      return duration <= Clock::duration::zero();
+    }
+    void await_suspend(std::coroutine_handle<> handle) {
+      loop->ScheduleAt(Clock::now() + duration, handle);
+    }
+    void await_resume() const noexcept {
+    }
+  };
+
+  SleepAwaiter SleepFor(Clock::duration duration) {
+    return SleepAwaiter{this, duration};
+  }
+};
+
+std::coroutine_handle<> Task::promise_type::FinalAwaiter::await_suspend(
+    std::coroutine_handle<promise_type> handle) noexcept {
+  promise_type &promise = handle.promise();
+  if (promise.continuation) {
+    return promise.continuation;
+  }
+  // Задача запущена через Spawn, ждать её некому.
+  if (promise.error) {
+    try {
+      std::rethrow_exception(promise.error);
+    } catch (const std::exception &e) {
+      std::cerr << "EventLoop: command failed: " << e.what() << "\n";
+    } catch (...) {
+      std::cerr << "EventLoop: command failed\n";
+    }
+  }
+  EventLoop *loop = promise.loop;
+  handle.destroy();
+  loop->OnTaskDone();
+  return std::noop_coroutine();
+}
+
+/**
+ * Получатель выполняет «медленные» операции асинхронно.
+ */
+class Receiver {
+ private:
+  EventLoop *loop_;
+  std::chrono::milliseconds latency_;
+  bool verbose_;
+
+ public:
+  Receiver(EventLoop *loop, std::chrono::milliseconds latency, bool verbose = true)
+      : loop_(loop), latency_(latency), verbose_(verbose) {
+  }
+  Task DoSomething(std::string a) {
+    if (verbose_) {
+      std::cout << "Receiver: Working on (" << a << ".)\n";
+    }
+    co_await loop_->SleepFor(latency_);
+    if (verbose_) {
+      std::cout << "Receiver: Done with (" << a << ".)\n";
+    }
+  }
+  Task DoSomethingElse(std::string b) {
+    if (verbose_) {
+      std::cout << "Receiver: Also working on (" << b << ".)\n";
+    }
+    co_await loop_->SleepFor(latency_);
+    if (verbose_) {
+      std::cout << "Receiver: Done with (" << b << ".)\n";
+    }
+  }
+  bool verbose() const {
+    return verbose_;
+  }
+};
+
+/**
+ * Интерфейс асинхронной Команды: Execute возвращает сопрограмму.
+ */
+class AsyncCommand {
+ public:
+  virtual ~AsyncCommand() {
+  }
+  virtual Task Execute() = 0;
+};
+
+class SimpleCommand : public AsyncCommand {
+ private:
+  std::string pay_load_;
+
+ public:
+  explicit SimpleCommand(std::string pay_load) : pay_load_(std::move(pay_load)) {
+  }
+  Task Execute() override {
+    std::cout << "SimpleCommand: See, I can do simple things like printing (" << this->pay_load_ << ")\n";
+    co_return;
+  }
+};
+
+class ComplexCommand : public AsyncCommand {
+ private:
+  Receiver *receiver_;
+  std::string a_;
+  std::string b_;
+
+ public:
+  ComplexCommand(Receiver *receiver, std::string a, std::string b)
+      : receiver_(receiver), a_(std::move(a)), b_(std::move(b)) {
+  }
+  Task Execute() override {
+    if (this->receiver_->verbose()) {
+      std::cout << "ComplexCommand: Complex stuff should be done by a receiver object.\n";
+    }
+    co_await this->receiver_->DoSomething(this->a_);
+    co_await this->receiver_->DoSomethingElse(this->b_);
+  }
+};
+
+/**
+ * Владеет командой, пока та выполняется.
+ */
+Task RunCommand(std::unique_ptr<AsyncCommand> command) {
+  co_await command->Execute();
+}
+
+void ClientCode() {
+  EventLoop loop;
+  Receiver receiver(&loop, std::chrono::milliseconds(10));
+  std::cout << "Client: two complex commands share one thread while they wait.\n";
+  loop.Spawn(RunCommand(std::make_unique<SimpleCommand>("Say Hi!")));
+  loop.Spawn(RunCommand(std::make_unique<ComplexCommand>(&receiver, "Send email", "Save report")));
+  loop.Spawn(RunCommand(std::make_unique<ComplexCommand>(&receiver, "Send invoice", "Save invoice")));
+  loop.Run();
+  std::cout << "\n";
+}
+
+/**
+ * 10k одновременных команд, каждая дважды ждёт «ввод-вывод» по 10 мс.
+ * Сравниваются цикл событий (1 поток и все аппаратные потоки) и отдельный
+ * поток на каждую блокирующую команду.
+ */
+void Benchmark(std::size_t in_flight) {
+  const std::chrono::milliseconds kLatency(10);
+  unsigned hardware_threads = std::max(1u, std::thread::hardware_concurrency());
+  std::cout << "Benchmark: " << in_flight << " in-flight commands, 2 x " << kLatency.count() << " ms I/O each\n";
+
+  std::vector<unsigned> loop_threads(1, 1u);
+  if (hardware_threads > 1) {
+    loop_threads.push_back(hardware_threads);
+  }
+  for (unsigned threads : loop_threads) {
+    EventLoop loop;
+    Receiver receiver(&loop, kLatency, false);
+    EventLoop::Clock::time_point start = EventLoop::Clock::now();
+    for (std::size_t i = 0; i < in_flight; i++) {
+      loop.Spawn(RunCommand(std::make_unique<ComplexCommand>(&receiver, "Send email", "Save report")));
+    }
+    loop.Run(threads);
+    double ms = std::chrono::duration<double, std::milli>(EventLoop::Clock::now() - start).count();
+    std::cout << "Coroutines, " << threads << " loop thread(s): " << ms << " ms\n";
+  }
+
+  EventLoop::Clock::time_point start = EventLoop::Clock::now();
+  std::vector<std::thread> threads;
+  threads.reserve(in_flight);
+  try {
+    for (std::size_t i = 0; i < in_flight; i++) {
+      threads.emplace_back([kLatency] {
+        std::this_thread::sleep_for(kLatency);  // "Send email"
+        std::this_thread::sleep_for(kLatency);  // "Save report"
+      });
+    }
+  } catch (const std::system_error &e) {
+    std::cout << "Thread per command: stopped after " << threads.size() << " threads (" << e.what() << ")\n";
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  double ms = std::chrono::duration<double, std::milli>(EventLoop::Clock::now() - start).count();
+  std::cout << "Thread per command, " << threads.size() << " threads: " << ms << " ms\n";
+}
+
+int main() {
+  ClientCode();
+  Benchmark(10000);
+  return 0;
+}
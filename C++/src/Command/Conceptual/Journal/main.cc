@@ -0,0 +1,463 @@
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * Паттерн Команда
+ *
+ * Назначение: Превращает запросы в объекты, позволяя передавать их как
+ * аргументы при вызове методов, ставить запросы в очередь, логировать их, а
+ * также поддерживать отмену операций.
+ *
+ * Этот вариант показывает журналирование команд. Перед выполнением каждая
+ * команда сериализуется в компактный двоичный журнал (write-ahead log) и
+ * сбрасывается на диск. Чтобы не платить за fsync на каждую команду,
+ * журнал использует групповую фиксацию: пока один поток выполняет fsync,
+ * остальные дописывают свои записи в общий буфер, и следующий fsync
+ * фиксирует их все сразу. После сбоя журнал читается целиком и команды
+ * заново выполняются через Получателя.
+ *
+ * Пример использует POSIX-вызовы open/write/fsync.
+ */
+
+/**
+ * Получатель. В режиме восстановления и в замерах он работает «молча».
+ */
+class Receiver {
+ private:
+  bool verbose_;
+  std::size_t work_done_;
+
+ public:
+  explicit Receiver(bool verbose = true) : verbose_(verbose), work_done_(0) {
+  }
+  void DoSomething(const std::string &a) {
+    work_done_ += a.size();
+    if (verbose_) {
+      std::cout << "Receiver: Working on (" << a << ".)\n";
+    }
+  }
+  void DoSomethingElse(const std::string &b) {
+    work_done_ += b.size();
+    if (verbose_) {
+      std::cout << "Receiver: Also working on (" << b << ".)\n";
+    }
+  }
+  bool verbose() const {
+    return verbose_;
+  }
+  std::size_t work_done() const {
+    return work_done_;
+  }
+};
+
+/**
+ * Команда, которую можно записать в журнал, умеет сериализовать свои данные.
+ * Код типа определяет, какой класс восстановит команду при чтении журнала.
+ */
+class Command {
+ public:
+  virtual ~Command() {
+  }
+  virtual void Execute() const = 0;
+  virtual std::uint8_t type() const = 0;
+  virtual void Serialize(std::string *out) const = 0;
+};
+
+/**
+ * Простейший двоичный формат: целые числа в little-endian, строки — длина и
+ * байты.
+ */
+void PutUint32(std::string *out, std::uint32_t value) {
+  for (int i = 0; i < 4; i++) {
+    out->push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+  }
+}
+
+void PutString(std::string *out, const std::string &value) {
+  PutUint32(out, static_cast<std::uint32_t>(value.size()));
+  out->append(value);
+}
+
+class Reader {
+ private:
+  const char *data_;
+  std::size_t size_;
+  std::size_t offset_;
+
+ public:
+  Reader(const char *data, std::size_t size) : data_(data), size_(size), offset_(0) {
+  }
+  bool GetUint32(std::uint32_t *value) {
+    if (offset_ + 4 > size_) {
+      return false;
+    }
+    *value = 0;
+    for (int i = 0; i < 4; i++) {
+      *value |= std::uint32_t(static_cast<unsigned char>(data_[offset_ + i])) << (8 * i);
+    }
+    offset_ += 4;
+    return true;
+  }
+  bool GetString(std::string *value) {
+    std::uint32_t size;
+    if (!GetUint32(&size) || offset_ + size > size_) {
+      return false;
+    }
+    value->assign(data_ + offset_, size);
+    offset_ += size;
+    return true;
+  }
+  bool GetBytes(const char **bytes, std::size_t size) {
+    if (offset_ + size > size_) {
+      return false;
+    }
+    *bytes = data_ + offset_;
+    offset_ += size;
+    return true;
+  }
+  std::size_t offset() const {
+    return offset_;
+  }
+};
+
+std::uint32_t Checksum(const char *data, std::size_t size) {
+  std::uint32_t hash = 2166136261u;
+  for (std::size_t i = 0; i < size; i++) {
+    hash = (hash ^ static_cast<unsigned char>(data[i])) * 16777619u;
+  }
+  return hash;
+}
+
+class SimpleCommand : public Command {
+ private:
+  std::string pay_load_;
+
+ public:
+  static const std::uint8_t kType = 1;
+
+  explicit SimpleCommand(std::string pay_load) : pay_load_(std::move(pay_load)) {
+  }
+  void Execute() const override {
+    std::cout << "SimpleCommand: See, I can do simple things like printing (" << this->pay_load_ << ")\n";
+  }
+  std::uint8_t type() const override {
+    return kType;
+  }
+  void Serialize(std::string *out) const override {
+    PutString(out, pay_load_);
+  }
+};
+
+class ComplexCommand : public Command {
+ private:
+  Receiver *receiver_;
+  std::string a_;
+  std::string b_;
+
+ public:
+  static const std::uint8_t kType = 2;
+
+  ComplexCommand(Receiver *receiver, std::string a, std::string b)
+      : receiver_(receiver), a_(std::move(a)), b_(std::move(b)) {
+  }
+  void Execute() const override {
+    if (this->receiver_->verbose()) {
+      std::cout << "ComplexCommand: Complex stuff should be done by a receiver object.\n";
+    }
+    this->receiver_->DoSomething(this->a_);
+    this->receiver_->DoSomethingElse(this->b_);
+  }
+  std::uint8_t type() const override {
+    return kType;
+  }
+  void Serialize(std::string *out) const override {
+    PutString(out, a_);
+    PutString(out, b_);
+  }
+};
+
+/**
+ * Восстанавливает команду из её сериализованного представления. Получатель
+ * передаётся извне: в журнал пишутся только данные команды.
+ */
+Command *DecodeCommand(std::uint8_t type, Reader *reader, Receiver *receiver) {
+  switch (type) {
+    case SimpleCommand::kType: {
+      std::string pay_load;
+      if (!reader->GetString(&pay_load)) {
+        return nullptr;
+      }
+      return new SimpleCommand(pay_load);
+    }
+    case ComplexCommand::kType: {
+      std::string a, b;
+      if (!reader->GetString(&a) || !reader->GetString(&b)) {
+        return nullptr;
+      }
+      return new ComplexCommand(receiver, a, b);
+    }
+  }
+  return nullptr;
+}
+
+/**
+ * Журнал команд. Каждая запись — это длина, контрольная сумма и данные
+ * (код типа команды и её поля). Commit возвращает управление только после
+ * того, как запись попала на диск.
+ */
+class CommandJournal {
+ private:
+  int fd_;
+  bool group_commit_;
+  std::mutex mutex_;
+  std::condition_variable flushed_;
+  std::string pending_;
+  std::uint64_t appended_;
+  std::uint64_t durable_;
+  bool flushing_;
+  bool broken_;
+  std::uint64_t fsync_count_;
+
+  static void Encode(const Command &command, std::string *out) {
+    std::string payload;
+    payload.push_back(static_cast<char>(command.type()));
+    command.Serialize(&payload);
+    PutUint32(out, static_cast<std::uint32_t>(payload.size()));
+    PutUint32(out, Checksum(payload.data(), payload.size()));
+    out->append(payload);
+  }
+
+  void WriteAndSync(const std::string &bytes) {
+    std::size_t written = 0;
+    while (written < bytes.size()) {
+      ssize_t n = ::write(fd_, bytes.data() + written, bytes.size() - written);
+      if (n < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        throw std::runtime_error("CommandJournal: write failed");
+      }
+      written += static_cast<std::size_t>(n);
+    }
+    if (::fsync(fd_) != 0) {
+      throw std::runtime_error("CommandJournal: fsync failed");
+    }
+  }
+
+ public:
+  CommandJournal(const std::string &path, bool group_commit)
+      : group_commit_(group_commit), appended_(0), durable_(0), flushing_(false), broken_(false), fsync_count_(0) {
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd_ < 0) {
+      throw std::runtime_error("CommandJournal: cannot open " + path);
+    }
+  }
+
+  ~CommandJournal() {
+    ::close(fd_);
+  }
+
+  /**
+   * Без групповой фиксации каждая запись пишется и синхронизируется под
+   * мьютексом. С групповой фиксацией первый ожидающий поток становится
+   * «лидером»: он забирает весь накопленный буфер, пишет его одним write и
+   * одним fsync, а затем будит остальных.
+   *
+   * Если запись на диск не удалась, неизвестно, какие записи пачки дошли до
+   * диска, поэтому журнал переходит в сломанное состояние и все ожидающие и
+   * последующие вызовы Commit выбрасывают исключение.
+   */
+  void Commit(const Command &command) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (broken_) {
+      throw std::runtime_error("CommandJournal: journal is broken");
+    }
+    Encode(command, &pending_);
+    std::uint64_t sequence = ++appended_;
+    if (!group_commit_) {
+      try {
+        WriteAndSync(pending_);
+      } catch (...) {
+        broken_ = true;
+        throw;
+      }
+      pending_.clear();
+      durable_ = sequence;
+      fsync_count_++;
+      return;
+    }
+    while (durable_ < sequence) {
+      if (broken_) {
+        throw std::runtime_error("CommandJournal: journal is broken");
+      }
+      if (flushing_) {
+        flushed_.wait(lock);
+        continue;
+      }
+      flushing_ = true;
+      std::string batch;
+      batch.swap(pending_);
+      std::uint64_t batch_end = appended_;
+      lock.unlock();
+      try {
+        WriteAndSync(batch);
+      } catch (...) {
+        lock.lock();
+        flushing_ = false;
+        broken_ = true;
+        flushed_.notify_all();
+        throw;
+      }
+      lock.lock();
+      durable_ = batch_end;
+      flushing_ = false;
+      fsync_count_++;
+      flushed_.notify_all();
+    }
+  }
+
+  std::uint64_t fsync_count() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return fsync_count_;
+  }
+
+  /**
+   * Читает журнал одним куском и выполняет все целые записи. Запись с
+   * неверной контрольной суммой или оборванная на середине считается
+   * недописанным «хвостом» после сбоя: чтение на ней останавливается, а
+   * хвост обрезается, чтобы новые записи не оказались после мусора.
+   * Возвращает количество восстановленных команд.
+   */
+  static std::size_t Replay(const std::string &path, Receiver *receiver) {
+    std::string bytes;
+    std::FILE *file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+      return 0;
+    }
+    char buffer[1 << 16];
+    std::size_t n;
+    while ((n = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+      bytes.append(buffer, n);
+    }
+    std::fclose(file);
+
+    Reader reader(bytes.data(), bytes.size());
+    std::size_t replayed = 0;
+    std::size_t valid_bytes = 0;
+    std::uint32_t size, checksum;
+    const char *payload;
+    while (reader.GetUint32(&size) && reader.GetUint32(&checksum) && reader.GetBytes(&payload, size)) {
+      if (size == 0 || Checksum(payload, size) != checksum) {
+        break;
+      }
+      Reader fields(payload + 1, size - 1);
+      Command *command = DecodeCommand(static_cast<std::uint8_t>(payload[0]), &fields, receiver);
+      if (command == nullptr) {
+        break;
+      }
+      command->Execute();
+      delete command;
+      replayed++;
+      valid_bytes = reader.offset();
+    }
+    if (valid_bytes < bytes.size() && ::truncate(path.c_str(), static_cast<off_t>(valid_bytes)) != 0) {
+      throw std::runtime_error("CommandJournal: cannot truncate " + path);
+    }
+    return replayed;
+  }
+};
+
+/**
+ * Отправитель сначала фиксирует команду в журнале и только потом выполняет
+ * её. Команда, выполнение которой началось, гарантированно есть на диске.
+ */
+class Invoker {
+ private:
+  CommandJournal *journal_;
+
+ public:
+  explicit Invoker(CommandJournal *journal) : journal_(journal) {
+  }
+  void Submit(Command *command) {
+    this->journal_->Commit(*command);
+    command->Execute();
+    delete command;
+  }
+};
+
+void ClientCode(const std::string &path) {
+  std::remove(path.c_str());
+  Receiver receiver;
+  {
+    CommandJournal journal(path, true);
+    Invoker invoker(&journal);
+    std::cout << "Client: executing commands with a journal.\n";
+    invoker.Submit(new SimpleCommand("Say Hi!"));
+    invoker.Submit(new ComplexCommand(&receiver, "Send email", "Save report"));
+  }
+  // Имитируем оборванную запись, как будто процесс упал посреди write.
+  std::FILE *file = std::fopen(path.c_str(), "ab");
+  std::fwrite("\x20\x00\x00\x00garbage", 1, 11, file);
+  std::fclose(file);
+
+  std::cout << "\nClient: restarting and replaying the journal.\n";
+  std::size_t replayed = CommandJournal::Replay(path, &receiver);
+  std::cout << "Client: replayed " << replayed << " commands, torn tail dropped.\n\n";
+  std::remove(path.c_str());
+}
+
+void Benchmark(const std::string &path, bool group_commit, unsigned thread_count, std::size_t per_thread) {
+  std::remove(path.c_str());
+  Receiver receiver(false);
+  double seconds;
+  std::uint64_t fsyncs;
+  {
+    CommandJournal journal(path, group_commit);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < thread_count; t++) {
+      threads.push_back(std::thread([&journal, &receiver, per_thread] {
+        for (std::size_t i = 0; i < per_thread; i++) {
+          ComplexCommand command(&receiver, "Send email", "Save report");
+          journal.Commit(command);
+        }
+      }));
+    }
+    for (std::size_t i = 0; i < threads.size(); i++) {
+      threads[i].join();
+    }
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    fsyncs = journal.fsync_count();
+  }
+  std::size_t commits = thread_count * per_thread;
+  std::cout << (group_commit ? "Group commit on:  " : "Group commit off: ") << commits / seconds
+            << " commits/s, " << double(commits) / fsyncs << " commits/fsync\n";
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  std::size_t replayed = CommandJournal::Replay(path, &receiver);
+  seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::cout << "  replay: " << replayed << " commands at " << replayed / seconds / 1e6 << " M commands/s\n";
+  std::remove(path.c_str());
+}
+
+int main() {
+  ClientCode("command_journal.bin");
+  std::cout << "Benchmark: 16 submitting threads\n";
+  Benchmark("command_journal.bin", false, 16, 2000);
+  Benchmark("command_journal.bin", true, 16, 2000);
+  return 0;
+}
@@ -0,0 +1,364 @@
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * Паттерн Команда
+ *
+ * Назначение: Превращает запросы в объекты, позволяя передавать их как
+ * аргументы при вызове методов, ставить запросы в очередь, логировать их, а
+ * также поддерживать отмену операций.
+ *
+ * Этот вариант добавляет планировщик команд с классами приоритета и
+ * крайними сроками. Срочные команды выполняются раньше фоновых, внутри
+ * класса — в порядке ближайшего крайнего срока. Команду с истёкшим сроком
+ * планировщик либо отбрасывает, либо откладывает в фоновый класс, в
+ * зависимости от политики, указанной при постановке в очередь. Для каждого
+ * класса собирается статистика времени ожидания в очереди.
+ */
+/**
+ * Интерфейс Команды объявляет метод для выполнения команд.
+ */
+class Command {
+ public:
+  virtual ~Command() {
+  }
+  virtual void Execute() const = 0;
+};
+
+class SimpleCommand : public Command {
+ private:
+  std::string pay_load_;
+
+ public:
+  explicit SimpleCommand(std::string pay_load) : pay_load_(std::move(pay_load)) {
+  }
+  void Execute() const override {
+    std::cout << "SimpleCommand: See, I can do simple things like printing (" << this->pay_load_ << ")\n";
+  }
+};
+
+class Receiver {
+ public:
+  void DoSomething(const std::string &a) {
+    std::cout << "Receiver: Working on (" << a << ".)\n";
+  }
+  void DoSomethingElse(const std::string &b) {
+    std::cout << "Receiver: Also working on (" << b << ".)\n";
+  }
+};
+
+class ComplexCommand : public Command {
+ private:
+  Receiver *receiver_;
+  std::string a_;
+  std::string b_;
+
+ public:
+  ComplexCommand(Receiver *receiver, std::string a, std::string b)
+      : receiver_(receiver), a_(std::move(a)), b_(std::move(b)) {
+  }
+  void Execute() const override {
+    std::cout << "ComplexCommand: Complex stuff should be done by a receiver object.\n";
+    this->receiver_->DoSomething(this->a_);
+    this->receiver_->DoSomethingElse(this->b_);
+  }
+};
+
+enum Priority {
+  PRIORITY_CRITICAL = 0,
+  PRIORITY_NORMAL,
+  PRIORITY_BULK,
+  PRIORITY_COUNT
+};
+
+const char *PriorityName(Priority priority) {
+  switch (priority) {
+    case PRIORITY_CRITICAL:
+      return "critical";
+    case PRIORITY_NORMAL:
+      return "normal";
+    default:
+      return "bulk";
+  }
+}
+
+/**
+ * Что делать с командой, срок которой истёк, пока она ждала в очереди.
+ */
+enum ExpiryPolicy {
+  EXPIRY_DROP = 0,
+  EXPIRY_DEFER
+};
+
+/**
+ * Статистика одного класса приоритета.
+ */
+struct ClassStats {
+  std::uint64_t executed;
+  std::uint64_t dropped;
+  std::uint64_t deferred;
+  std::chrono::nanoseconds total_wait;
+  std::chrono::nanoseconds max_wait;
+
+  ClassStats() : executed(0), dropped(0), deferred(0), total_wait(0), max_wait(0) {
+  }
+};
+
+/**
+ * Планировщик команд. Submit потокобезопасен. Команды выполняет либо
+ * вызывающий поток через RunPending, либо рабочие потоки через Run.
+ */
+class CommandScheduler {
+ public:
+  typedef std::chrono::steady_clock Clock;
+
+ private:
+  struct Entry {
+    Command *command;
+    Clock::time_point enqueued;
+    Clock::time_point deadline;
+    ExpiryPolicy policy;
+    Priority priority;
+    std::uint64_t sequence;
+  };
+
+  /**
+   * Внутри класса раньше выполняется команда с ближайшим сроком, при равных
+   * сроках — поставленная раньше.
+   */
+  struct LaterDeadline {
+    bool operator()(const Entry &a, const Entry &b) const {
+      if (a.deadline != b.deadline) {
+        return a.deadline > b.deadline;
+      }
+      return a.sequence > b.sequence;
+    }
+  };
+
+  std::mutex mutex_;
+  std::condition_variable ready_;
+  std::priority_queue<Entry, std::vector<Entry>, LaterDeadline> queues_[PRIORITY_COUNT];
+  ClassStats stats_[PRIORITY_COUNT];
+  std::uint64_t sequence_;
+  bool use_priorities_;
+  bool stopped_;
+
+  /**
+   * Выбирает следующую команду для выполнения. Просроченные команды по пути
+   * отбрасываются или переносятся в фоновый класс. Вызывается под мьютексом.
+   */
+  bool Next(Entry *entry, Priority *priority) {
+    for (int p = 0; p < PRIORITY_COUNT; p++) {
+      while (!queues_[p].empty()) {
+        Entry top = queues_[p].top();
+        queues_[p].pop();
+        Clock::time_point now = Clock::now();
+        ClassStats &stats = stats_[top.priority];
+        if (now > top.deadline) {
+          if (top.policy == EXPIRY_DROP) {
+            stats.dropped++;
+            delete top.command;
+            continue;
+          }
+          stats.deferred++;
+          top.deadline = Clock::time_point::max();
+          queues_[PRIORITY_BULK].push(top);
+          continue;
+        }
+        *entry = top;
+        *priority = top.priority;
+        std::chrono::nanoseconds wait = std::chrono::duration_cast<std::chrono::nanoseconds>(now - top.enqueued);
+        stats.executed++;
+        stats.total_wait += wait;
+        stats.max_wait = std::max(stats.max_wait, wait);
+        return true;
+      }
+    }
+    return false;
+  }
+
+ public:
+  /**
+   * Если use_priorities == false, все команды стоят в одной очереди
+   * (normal) в порядке сроков и поступления, но статистика по-прежнему
+   * ведётся по классу, указанному в Submit. Так можно сравнить ожидание
+   * каждого класса с классами и без них.
+   */
+  explicit CommandScheduler(bool use_priorities = true)
+      : sequence_(0), use_priorities_(use_priorities), stopped_(false) {
+  }
+
+  ~CommandScheduler() {
+    for (int p = 0; p < PRIORITY_COUNT; p++) {
+      while (!queues_[p].empty()) {
+        delete queues_[p].top().command;
+        queues_[p].pop();
+      }
+    }
+  }
+
+  /**
+   * Ставит команду в очередь. Планировщик становится её владельцем. Без
+   * указания срока команда ждёт сколько угодно.
+   */
+  void Submit(Command *command, Priority priority) {
+    Submit(command, priority, Clock::time_point::max(), EXPIRY_DEFER);
+  }
+
+  void Submit(Command *command, Priority priority, Clock::duration budget, ExpiryPolicy policy) {
+    Submit(command, priority, Clock::now() + budget, policy);
+  }
+
+  void Submit(Command *command, Priority priority, Clock::time_point deadline, ExpiryPolicy policy) {
+    Entry entry;
+    entry.command = command;
+    entry.enqueued = Clock::now();
+    entry.deadline = deadline;
+    entry.policy = policy;
+    entry.priority = priority;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      entry.sequence = sequence_++;
+      queues_[use_priorities_ ? priority : PRIORITY_NORMAL].push(entry);
+    }
+    ready_.notify_one();
+  }
+
+  /**
+   * Выполняет все команды, уже стоящие в очереди, в вызывающем потоке.
+   */
+  void RunPending() {
+    Entry entry;
+    Priority priority;
+    for (;;) {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!Next(&entry, &priority)) {
+          return;
+        }
+      }
+      entry.command->Execute();
+      delete entry.command;
+    }
+  }
+
+  /**
+   * Цикл рабочего потока: выполняет команды, пока не будет вызван Stop и
+   * очередь не опустеет.
+   */
+  void Run() {
+    Entry entry;
+    Priority priority;
+    for (;;) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!Next(&entry, &priority)) {
+          if (stopped_) {
+            return;
+          }
+          ready_.wait(lock);
+        }
+      }
+      entry.command->Execute();
+      delete entry.command;
+    }
+  }
+
+  void Stop() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopped_ = true;
+    }
+    ready_.notify_all();
+  }
+
+  void PrintStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (int p = 0; p < PRIORITY_COUNT; p++) {
+      const ClassStats &s = stats_[p];
+      double mean_us = s.executed == 0 ? 0.0 : s.total_wait.count() / 1e3 / s.executed;
+      std::cout << "  " << PriorityName(static_cast<Priority>(p)) << ": executed=" << s.executed
+                << " dropped=" << s.dropped << " deferred=" << s.deferred << " mean wait=" << mean_us
+                << "us max wait=" << s.max_wait.count() / 1e3 << "us\n";
+    }
+  }
+};
+
+void ClientCode() {
+  CommandScheduler scheduler;
+  Receiver receiver;
+  std::chrono::steady_clock::duration expired = std::chrono::steady_clock::duration::zero();
+
+  scheduler.Submit(new SimpleCommand("Bulk export 1"), PRIORITY_BULK);
+  scheduler.Submit(new SimpleCommand("Bulk export 2"), PRIORITY_BULK);
+  scheduler.Submit(new ComplexCommand(&receiver, "Send email", "Save report"), PRIORITY_NORMAL);
+  scheduler.Submit(new SimpleCommand("Say Hi!"), PRIORITY_CRITICAL);
+  // Срок этих двух команд истекает сразу: первая будет отброшена, вторая
+  // отложена в фоновый класс.
+  scheduler.Submit(new SimpleCommand("Stale price update"), PRIORITY_CRITICAL, expired, EXPIRY_DROP);
+  scheduler.Submit(new SimpleCommand("Late audit record"), PRIORITY_NORMAL, expired, EXPIRY_DEFER);
+  std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+  std::cout << "Scheduler: running queued commands.\n";
+  scheduler.RunPending();
+  scheduler.PrintStats();
+  std::cout << "\n";
+}
+
+/**
+ * Команда, имитирующая работу заданной длительности.
+ */
+class BusyCommand : public Command {
+ private:
+  std::chrono::microseconds duration_;
+
+ public:
+  explicit BusyCommand(std::chrono::microseconds duration) : duration_(duration) {
+  }
+  void Execute() const override {
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now() + duration_;
+    while (std::chrono::steady_clock::now() < end) {
+    }
+  }
+};
+
+/**
+ * Один рабочий поток и одна и та же смесь команд в обоих прогонах: поток
+ * фоновых команд по 20 мкс, обычные по 10 мкс и срочные по 5 мкс. Без
+ * классов все команды стоят в одной очереди, и срочные ждут за фоновыми.
+ */
+void Benchmark(bool use_priorities) {
+  CommandScheduler scheduler(use_priorities);
+  for (int i = 0; i < 2000; i++) {
+    scheduler.Submit(new BusyCommand(std::chrono::microseconds(20)), PRIORITY_BULK);
+  }
+  std::thread worker(&CommandScheduler::Run, &scheduler);
+  for (int i = 0; i < 100; i++) {
+    scheduler.Submit(new BusyCommand(std::chrono::microseconds(5)), PRIORITY_CRITICAL);
+    if (i % 2 == 0) {
+      scheduler.Submit(new BusyCommand(std::chrono::microseconds(10)), PRIORITY_NORMAL);
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+  }
+  scheduler.Stop();
+  worker.join();
+  std::cout << (use_priorities ? "With priority classes:\n" : "Single FIFO class:\n");
+  scheduler.PrintStats();
+}
+
+int main() {
+  ClientCode();
+  Benchmark(false);
+  Benchmark(true);
+  return 0;
+}
@@ -0,0 +1,390 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * Паттерн Команда
+ *
+ * Назначение: Превращает запросы в объекты, позволяя передавать их как
+ * аргументы при вызове методов, ставить запросы в очередь, логировать их, а
+ * также поддерживать отмену операций.
+ *
+ * В классическом примере каждая команда создаётся через new и выполняется
+ * через виртуальный Execute. Этот вариант добавляет InlineCommand — команду со
+ * стёртым типом, которая хранит конкретную команду прямо в себе, во
+ * встроенном буфере фиксированного размера. InlineCommand можно только
+ * перемещать, а постановка в очередь и выполнение типичных команд не выделяют
+ * память в куче.
+ */
+
+/**
+ * Счётчик выделений памяти, чтобы было видно, сколько раз каждая из схем
+ * обращается к куче. operator new и operator delete не встраиваются: иначе
+ * GCC видит free для указателя от malloc и предупреждает о несовпадении.
+ */
+static std::size_t g_allocations = 0;
+
+__attribute__((noinline)) void *operator new(std::size_t size) {
+  g_allocations++;
+  void *p = std::malloc(size == 0 ? 1 : size);
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept {
+  std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void *p, std::size_t) noexcept {
+  std::free(p);
+}
+
+/**
+ * Интерфейс Команды объявляет метод для выполнения команд.
+ */
+class Command {
+ public:
+  virtual ~Command() {
+  }
+  virtual void Execute() const = 0;
+};
+
+class SimpleCommand : public Command {
+ private:
+  std::string pay_load_;
+
+ public:
+  explicit SimpleCommand(std::string pay_load) : pay_load_(std::move(pay_load)) {
+  }
+  void Execute() const override {
+    std::cout << "SimpleCommand: See, I can do simple things like printing (" << this->pay_load_ << ")\n";
+  }
+};
+
+/**
+ * Получатель умеет работать «молча»: в замерах он только считает
+ * выполненную работу, чтобы не измерять скорость std::cout.
+ */
+class Receiver {
+ private:
+  bool verbose_;
+  std::size_t work_done_;
+
+ public:
+  explicit Receiver(bool verbose = true) : verbose_(verbose), work_done_(0) {
+  }
+  void DoSomething(const std::string &a) {
+    work_done_ += a.size();
+    if (verbose_) {
+      std::cout << "Receiver: Working on (" << a << ".)\n";
+    }
+  }
+  void DoSomethingElse(const std::string &b) {
+    work_done_ += b.size();
+    if (verbose_) {
+      std::cout << "Receiver: Also working on (" << b << ".)\n";
+    }
+  }
+  bool verbose() const {
+    return verbose_;
+  }
+  std::size_t work_done() const {
+    return work_done_;
+  }
+};
+
+/**
+ * Строки контекста принимаются по значению и перемещаются в поля, поэтому
+ * конструктор больше не копирует их второй раз.
+ */
+class ComplexCommand : public Command {
+ private:
+  Receiver *receiver_;
+  std::string a_;
+  std::string b_;
+
+ public:
+  ComplexCommand(Receiver *receiver, std::string a, std::string b)
+      : receiver_(receiver), a_(std::move(a)), b_(std::move(b)) {
+  }
+  void Execute() const override {
+    if (this->receiver_->verbose()) {
+      std::cout << "ComplexCommand: Complex stuff should be done by a receiver object.\n";
+    }
+    this->receiver_->DoSomething(this->a_);
+    this->receiver_->DoSomethingElse(this->b_);
+  }
+};
+
+/**
+ * Команда со стёртым типом. Подходит любой тип с методом `void Execute()
+ * const`, в том числе существующие наследники Command. Объект размещается во
+ * встроенном буфере; если он туда не помещается, это ошибка компиляции, а не
+ * тихое выделение памяти в куче.
+ *
+ * Вместо виртуальной таблицы используется статическая таблица из трёх
+ * указателей на функции для конкретного типа. Execute вызывается через неё
+ * квалифицированно, то есть без второго виртуального вызова.
+ */
+class InlineCommand {
+ public:
+  static const std::size_t kCapacity = 96;
+
+ private:
+  struct Operations {
+    void (*execute)(const void *self);
+    void (*move)(void *to, void *from);
+    void (*destroy)(void *self);
+  };
+
+  template <typename T>
+  struct OperationsFor {
+    static void Execute(const void *self) {
+      static_cast<const T *>(self)->T::Execute();
+    }
+    static void Move(void *to, void *from) {
+      new (to) T(std::move(*static_cast<T *>(from)));
+    }
+    static void Destroy(void *self) {
+      static_cast<T *>(self)->~T();
+    }
+    static const Operations kOperations;
+  };
+
+  typename std::aligned_storage<kCapacity, alignof(std::max_align_t)>::type storage_;
+  const Operations *operations_;
+
+  template <typename Concrete>
+  static void CheckFits() {
+    static_assert(sizeof(Concrete) <= kCapacity, "command does not fit into InlineCommand::kCapacity");
+    static_assert(alignof(Concrete) <= alignof(std::max_align_t), "command is over-aligned");
+    static_assert(std::is_nothrow_move_constructible<Concrete>::value, "command move may throw");
+  }
+
+ public:
+  InlineCommand() : operations_(nullptr) {
+  }
+
+  template <typename T, typename = typename std::enable_if<
+                            !std::is_same<typename std::decay<T>::type, InlineCommand>::value>::type>
+  InlineCommand(T &&command) : operations_(&OperationsFor<typename std::decay<T>::type>::kOperations) {
+    typedef typename std::decay<T>::type Concrete;
+    CheckFits<Concrete>();
+    new (&storage_) Concrete(std::forward<T>(command));
+  }
+
+  InlineCommand(InlineCommand &&other) noexcept : operations_(other.operations_) {
+    if (operations_ != nullptr) {
+      operations_->move(&storage_, &other.storage_);
+      other.Reset();
+    }
+  }
+
+  InlineCommand &operator=(InlineCommand &&other) noexcept {
+    if (this != &other) {
+      Reset();
+      operations_ = other.operations_;
+      if (operations_ != nullptr) {
+        operations_->move(&storage_, &other.storage_);
+        other.Reset();
+      }
+    }
+    return *this;
+  }
+
+  InlineCommand(const InlineCommand &) = delete;
+  InlineCommand &operator=(const InlineCommand &) = delete;
+
+  ~InlineCommand() {
+    Reset();
+  }
+
+  /**
+   * Создаёт команду типа T прямо во встроенном буфере, без промежуточного
+   * объекта и перемещений.
+   */
+  template <typename T, typename... Args>
+  void Emplace(Args &&... args) {
+    CheckFits<T>();
+    Reset();
+    new (&storage_) T(std::forward<Args>(args)...);
+    operations_ = &OperationsFor<T>::kOperations;
+  }
+
+  void Reset() {
+    if (operations_ != nullptr) {
+      operations_->destroy(&storage_);
+      operations_ = nullptr;
+    }
+  }
+
+  explicit operator bool() const {
+    return operations_ != nullptr;
+  }
+
+  void Execute() const {
+    operations_->execute(&storage_);
+  }
+};
+
+template <typename T>
+const InlineCommand::Operations InlineCommand::OperationsFor<T>::kOperations = {
+    &InlineCommand::OperationsFor<T>::Execute, &InlineCommand::OperationsFor<T>::Move,
+    &InlineCommand::OperationsFor<T>::Destroy};
+
+/**
+ * Кольцевая очередь команд фиксированной ёмкости. Вся память выделяется
+ * один раз в конструкторе. Команды создаются прямо в ячейках очереди и
+ * выполняются там же.
+ */
+class CommandRing {
+ private:
+  std::vector<InlineCommand> slots_;
+  std::size_t head_;
+  std::size_t tail_;
+
+ public:
+  explicit CommandRing(std::size_t capacity) : slots_(capacity), head_(0), tail_(0) {
+  }
+
+  bool Push(InlineCommand &&command) {
+    if (tail_ - head_ == slots_.size()) {
+      return false;
+    }
+    slots_[tail_++ % slots_.size()] = std::move(command);
+    return true;
+  }
+
+  template <typename T, typename... Args>
+  bool Emplace(Args &&... args) {
+    if (tail_ - head_ == slots_.size()) {
+      return false;
+    }
+    slots_[tail_++ % slots_.size()].template Emplace<T>(std::forward<Args>(args)...);
+    return true;
+  }
+
+  bool Pop(InlineCommand *command) {
+    if (head_ == tail_) {
+      return false;
+    }
+    *command = std::move(slots_[head_++ % slots_.size()]);
+    return true;
+  }
+
+  /**
+   * Выполняет следующую команду на месте и освобождает ячейку.
+   */
+  bool ExecuteNext() {
+    if (head_ == tail_) {
+      return false;
+    }
+    InlineCommand &slot = slots_[head_++ % slots_.size()];
+    slot.Execute();
+    slot.Reset();
+    return true;
+  }
+};
+
+/**
+ * Отправитель из основного примера, но его слоты хранят InlineCommand.
+ */
+class Invoker {
+ private:
+  InlineCommand on_start_;
+  InlineCommand on_finish_;
+
+ public:
+  void SetOnStart(InlineCommand command) {
+    this->on_start_ = std::move(command);
+  }
+  void SetOnFinish(InlineCommand command) {
+    this->on_finish_ = std::move(command);
+  }
+  void DoSomethingImportant() {
+    std::cout << "Invoker: Does anybody want something done before I begin?\n";
+    if (this->on_start_) {
+      this->on_start_.Execute();
+    }
+    std::cout << "Invoker: ...doing something really important...\n";
+    std::cout << "Invoker: Does anybody want something done after I finish?\n";
+    if (this->on_finish_) {
+      this->on_finish_.Execute();
+    }
+  }
+};
+
+void ClientCode() {
+  Receiver receiver;
+  Invoker invoker;
+  invoker.SetOnStart(SimpleCommand("Say Hi!"));
+  invoker.SetOnFinish(ComplexCommand(&receiver, "Send email", "Save report"));
+  invoker.DoSomethingImportant();
+  std::cout << "\n";
+}
+
+/**
+ * Обе схемы ставят команды в очередь пачками по kBatch и сразу выполняют их.
+ *
+ * Строки контекста здесь короткие и помещаются во встроенный буфер
+ * std::string (SSO), поэтому у InlineCommand выходит 0 выделений на команду.
+ * Строки длиннее этого буфера выделяют память сами, в любой из схем.
+ */
+void Benchmark(std::size_t count) {
+  const std::size_t kBatch = 1024;
+  Receiver receiver(false);
+
+  std::vector<Command *> pointers;
+  pointers.reserve(kBatch);
+  std::size_t allocations_before = g_allocations;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (std::size_t done = 0; done < count; done += kBatch) {
+    for (std::size_t i = 0; i < kBatch; i++) {
+      pointers.push_back(new ComplexCommand(&receiver, "Send email", "Save report"));
+    }
+    for (std::size_t i = 0; i < pointers.size(); i++) {
+      pointers[i]->Execute();
+      delete pointers[i];
+    }
+    pointers.clear();
+  }
+  double heap_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::size_t heap_allocations = g_allocations - allocations_before;
+
+  CommandRing ring(kBatch);
+  allocations_before = g_allocations;
+  start = std::chrono::steady_clock::now();
+  for (std::size_t done = 0; done < count; done += kBatch) {
+    for (std::size_t i = 0; i < kBatch; i++) {
+      ring.Emplace<ComplexCommand>(&receiver, "Send email", "Save report");
+    }
+    while (ring.ExecuteNext()) {
+    }
+  }
+  double inline_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::size_t inline_allocations = g_allocations - allocations_before;
+
+  std::size_t executed = (count + kBatch - 1) / kBatch * kBatch;
+  std::cout << "Benchmark: " << executed << " ComplexCommands (work done " << receiver.work_done() << ")\n";
+  std::cout << "new + virtual Execute: " << executed / heap_seconds / 1e6 << " M commands/s, "
+            << double(heap_allocations) / executed << " allocations/command\n";
+  std::cout << "InlineCommand ring:    " << executed / inline_seconds / 1e6 << " M commands/s, "
+            << double(inline_allocations) / executed << " allocations/command\n";
+  std::cout << "sizeof(InlineCommand) = " << sizeof(InlineCommand)
+            << ", sizeof(ComplexCommand) = " << sizeof(ComplexCommand) << "\n";
+}
+
+int main() {
+  ClientCode();
+  Benchmark(5000000);
+  return 0;
+}
@@ -0,0 +1,342 @@
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Паттерн Команда
+ *
+ * Назначение: Превращает запросы в объекты, позволяя передавать их как
+ * аргументы при вызове методов, ставить запросы в очередь, логировать их, а
+ * также поддерживать отмену операций.
+ *
+ * Этот вариант добавляет командам отмену и историю отмены/повтора. Соседние
+ * совместимые команды (например, несколько DoSomething подряд над одним и тем
+ * же получателем) сливаются в одну запись истории. Поэтому история остаётся
+ * короткой даже при большом потоке команд, а её память ограничена: самые
+ * старые записи вытесняются.
+ */
+
+/**
+ * Получатель теперь хранит состояние, которое команды изменяют и
+ * восстанавливают: журнал работы и текущий статус.
+ */
+class Receiver {
+ private:
+  std::string work_;
+  std::string status_;
+
+ public:
+  void DoSomething(const std::string &a) {
+    work_ += a;
+  }
+  void UndoSomething(std::size_t size) {
+    work_.erase(work_.size() - size);
+  }
+  void DoSomethingElse(const std::string &b) {
+    status_ = b;
+  }
+  const std::string &work() const {
+    return work_;
+  }
+  const std::string &status() const {
+    return status_;
+  }
+};
+
+/**
+ * Интерфейс Команды. Кроме Execute команда умеет отменять своё действие и,
+ * если это возможно, поглощать следующую за ней команду.
+ */
+class Command {
+ public:
+  virtual ~Command() {
+  }
+  virtual void Execute() = 0;
+  virtual void Undo() = 0;
+  /**
+   * Пытается объединить next с этой командой. Если это удалось, результат
+   * выполнения и отмены объединённой команды совпадает с результатом
+   * последовательного выполнения и отмены обеих команд.
+   */
+  virtual bool MergeWith(const Command &) {
+    return false;
+  }
+  /**
+   * Приблизительный объём памяти, занимаемый командой в истории.
+   */
+  virtual std::size_t memory_size() const = 0;
+};
+
+/**
+ * Дописывает текст в журнал работы получателя. Соседние команды над одним
+ * получателем сливаются конкатенацией, пока объединённый текст не превысит
+ * kMaxMergedSize: так одна отмена не откатывает слишком много работы.
+ */
+class DoSomethingCommand : public Command {
+ public:
+  static const std::size_t kMaxMergedSize = 256;
+
+ private:
+  Receiver *receiver_;
+  std::string a_;
+
+ public:
+  DoSomethingCommand(Receiver *receiver, std::string a) : receiver_(receiver), a_(std::move(a)) {
+  }
+  void Execute() override {
+    this->receiver_->DoSomething(this->a_);
+  }
+  void Undo() override {
+    this->receiver_->UndoSomething(this->a_.size());
+  }
+  bool MergeWith(const Command &next) override {
+    const DoSomethingCommand *other = dynamic_cast<const DoSomethingCommand *>(&next);
+    if (other == nullptr || other->receiver_ != this->receiver_ ||
+        this->a_.size() + other->a_.size() > kMaxMergedSize) {
+      return false;
+    }
+    this->a_ += other->a_;
+    return true;
+  }
+  std::size_t memory_size() const override {
+    return sizeof(*this) + this->a_.capacity();
+  }
+};
+
+/**
+ * Меняет статус получателя. При слиянии сохраняется самое первое прежнее
+ * значение и самое последнее новое.
+ */
+class DoSomethingElseCommand : public Command {
+ private:
+  Receiver *receiver_;
+  std::string b_;
+  std::string previous_;
+
+ public:
+  DoSomethingElseCommand(Receiver *receiver, std::string b) : receiver_(receiver), b_(std::move(b)) {
+  }
+  void Execute() override {
+    this->previous_ = this->receiver_->status();
+    this->receiver_->DoSomethingElse(this->b_);
+  }
+  void Undo() override {
+    this->receiver_->DoSomethingElse(this->previous_);
+  }
+  bool MergeWith(const Command &next) override {
+    const DoSomethingElseCommand *other = dynamic_cast<const DoSomethingElseCommand *>(&next);
+    if (other == nullptr || other->receiver_ != this->receiver_) {
+      return false;
+    }
+    this->b_ = other->b_;
+    return true;
+  }
+  std::size_t memory_size() const override {
+    return sizeof(*this) + this->b_.capacity() + this->previous_.capacity();
+  }
+};
+
+/**
+ * История выполненных команд. Новая команда сначала выполняется, затем
+ * история пытается слить её с последней записью. Стек повтора очищается при
+ * каждой новой команде. Если память истории превышает лимит, самые старые
+ * записи удаляются — их уже нельзя отменить.
+ */
+class CommandHistory {
+ private:
+  std::deque<Command *> done_;
+  std::vector<Command *> undone_;
+  std::size_t memory_limit_;
+  std::size_t memory_used_;
+  bool merge_enabled_;
+  std::size_t executed_;
+  std::size_t merged_;
+  std::size_t evicted_;
+
+  void Clear(std::vector<Command *> *commands) {
+    for (std::size_t i = 0; i < commands->size(); i++) {
+      memory_used_ -= (*commands)[i]->memory_size();
+      delete (*commands)[i];
+    }
+    commands->clear();
+  }
+
+  /**
+   * Выполняет команду и пересчитывает её размер: Execute может изменить
+   * память, которую команда занимает.
+   */
+  void ExecuteAndMeasure(Command *command) {
+    std::size_t before = command->memory_size();
+    command->Execute();
+    memory_used_ = memory_used_ - before + command->memory_size();
+  }
+
+  void Evict() {
+    while (memory_used_ > memory_limit_ && done_.size() > 1) {
+      memory_used_ -= done_.front()->memory_size();
+      delete done_.front();
+      done_.pop_front();
+      evicted_++;
+    }
+  }
+
+ public:
+  explicit CommandHistory(std::size_t memory_limit, bool merge_enabled = true)
+      : memory_limit_(memory_limit),
+        memory_used_(0),
+        merge_enabled_(merge_enabled),
+        executed_(0),
+        merged_(0),
+        evicted_(0) {
+  }
+
+  ~CommandHistory() {
+    Clear(&undone_);
+    while (!done_.empty()) {
+      delete done_.back();
+      done_.pop_back();
+    }
+  }
+
+  /**
+   * История становится владельцем команды.
+   */
+  void Execute(Command *command) {
+    command->Execute();
+    executed_++;
+    Clear(&undone_);
+    if (merge_enabled_ && !done_.empty()) {
+      Command *last = done_.back();
+      std::size_t before = last->memory_size();
+      if (last->MergeWith(*command)) {
+        memory_used_ = memory_used_ - before + last->memory_size();
+        merged_++;
+        delete command;
+        Evict();
+        return;
+      }
+    }
+    done_.push_back(command);
+    memory_used_ += command->memory_size();
+    Evict();
+  }
+
+  bool Undo() {
+    if (done_.empty()) {
+      return false;
+    }
+    Command *command = done_.back();
+    done_.pop_back();
+    command->Undo();
+    undone_.push_back(command);
+    return true;
+  }
+
+  bool Redo() {
+    if (undone_.empty()) {
+      return false;
+    }
+    Command *command = undone_.back();
+    undone_.pop_back();
+    ExecuteAndMeasure(command);
+    done_.push_back(command);
+    Evict();
+    return true;
+  }
+
+  std::size_t size() const {
+    return done_.size();
+  }
+  std::size_t memory_used() const {
+    return memory_used_;
+  }
+  std::size_t executed() const {
+    return executed_;
+  }
+  std::size_t merged() const {
+    return merged_;
+  }
+  std::size_t evicted() const {
+    return evicted_;
+  }
+  double merge_hit_rate() const {
+    return executed_ == 0 ? 0.0 : double(merged_) / executed_;
+  }
+};
+
+void PrintState(const Receiver &receiver) {
+  std::cout << "Receiver: work = \"" << receiver.work() << "\", status = \"" << receiver.status() << "\"\n";
+}
+
+void ClientCode() {
+  Receiver receiver;
+  CommandHistory history(1 << 20);
+
+  std::cout << "Client: typing \"Send\", \" \", \"email\" and setting status twice.\n";
+  history.Execute(new DoSomethingCommand(&receiver, "Send"));
+  history.Execute(new DoSomethingCommand(&receiver, " "));
+  history.Execute(new DoSomethingCommand(&receiver, "email"));
+  history.Execute(new DoSomethingElseCommand(&receiver, "Saving"));
+  history.Execute(new DoSomethingElseCommand(&receiver, "Saved report"));
+  PrintState(receiver);
+  std::cout << "History: " << history.executed() << " commands, " << history.size() << " entries, "
+            << history.merged() << " merged\n";
+
+  std::cout << "Client: undo.\n";
+  history.Undo();
+  PrintState(receiver);
+  std::cout << "Client: undo.\n";
+  history.Undo();
+  PrintState(receiver);
+  std::cout << "Client: redo.\n";
+  history.Redo();
+  PrintState(receiver);
+  std::cout << "\n";
+}
+
+/**
+ * Поток мелких команд над несколькими получателями: в основном длинные серии
+ * над одним получателем, изредка переключение на другой.
+ */
+void Benchmark(std::size_t count, bool merge_enabled) {
+  std::vector<Receiver> receivers(4);
+  CommandHistory history(64 << 20, merge_enabled);
+  std::size_t receiver_index = 0;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < count; i++) {
+    if (i % 100 == 0) {
+      receiver_index = (receiver_index + 1) % receivers.size();
+    }
+    Receiver *receiver = &receivers[receiver_index];
+    if (i % 10 == 9) {
+      history.Execute(new DoSomethingElseCommand(receiver, "Saving"));
+    } else {
+      history.Execute(new DoSomethingCommand(receiver, "x"));
+    }
+  }
+  double execute_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::size_t entries = history.size();
+  std::size_t memory = history.memory_used();
+  start = std::chrono::steady_clock::now();
+  while (history.Undo()) {
+  }
+  double undo_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::cout << (merge_enabled ? "Merging on:  " : "Merging off: ") << count / execute_seconds / 1e6
+            << " M commands/s, hit rate " << history.merge_hit_rate() * 100 << "%, " << entries << " entries ("
+            << history.evicted() << " evicted), " << memory / 1024 << " KiB, undo all in "
+            << undo_seconds * 1e3 << " ms\n";
+}
+
+int main() {
+  ClientCode();
+  std::cout << "Benchmark: 1000000 commands, 64 MiB history limit\n";
+  Benchmark(1000000, false);
+  Benchmark(1000000, true);
+  return 0;
+}
@@ -0,0 +1,486 @@
+/**
+ * Паттерн Итератор
+ *
+ * Назначение: Даёт возможность последовательно обходить элементы составных
+ * объектов, не раскрывая их внутреннего представления.
+ *
+ * Этот вариант добавляет пакетный итератор. Вместо одного элемента за шаг он
+ * отдаёт непрерывный кусок (Span) элементов: сначала невыровненную «голову»,
+ * затем куски «тела», начало и длина которых кратны ширине вектора SIMD, и
+ * в конце короткий «хвост». Тело обрабатывают SIMD-ядра, голову и хвост —
+ * скалярный код. Подходящее ядро (AVX2, SSE2 или скалярное) выбирается при
+ * запуске по возможностям процессора.
+ *
+ * Ядра используют встроенные функции GCC/Clang для x86
+ * (__builtin_cpu_supports и атрибут target). На других архитектурах
+ * остаётся только скалярное ядро.
+ */
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BATCH_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <vector>
+
+/**
+ * Выравнивание тела в байтах: ширина регистра AVX2. Тело, выровненное для
+ * AVX2, выровнено и для SSE2.
+ */
+static const std::size_t kSimdAlignment = 32;
+
+/**
+ * Распределитель, выравнивающий память на kSimdAlignment. С ним начало
+ * контейнера не зависит от того, какой адрес вернул malloc, и разбиение на
+ * голову, тело и хвост воспроизводимо. Перед выровненным блоком хранится
+ * указатель на начало выделенной памяти.
+ */
+template <typename T>
+class AlignedAllocator {
+ public:
+  typedef T value_type;
+
+  AlignedAllocator() {
+  }
+  template <typename U>
+  AlignedAllocator(const AlignedAllocator<U> &) {
+  }
+
+  T *allocate(std::size_t n) {
+    void *raw = std::malloc(n * sizeof(T) + kSimdAlignment + sizeof(void *));
+    if (raw == nullptr) {
+      throw std::bad_alloc();
+    }
+    std::uintptr_t address = reinterpret_cast<std::uintptr_t>(raw) + sizeof(void *);
+    address += (kSimdAlignment - address % kSimdAlignment) % kSimdAlignment;
+    reinterpret_cast<void **>(address)[-1] = raw;
+    return reinterpret_cast<T *>(address);
+  }
+  void deallocate(T *p, std::size_t) {
+    std::free(reinterpret_cast<void **>(p)[-1]);
+  }
+};
+
+template <typename T, typename U>
+bool operator==(const AlignedAllocator<T> &, const AlignedAllocator<U> &) {
+  return true;
+}
+template <typename T, typename U>
+bool operator!=(const AlignedAllocator<T> &, const AlignedAllocator<U> &) {
+  return false;
+}
+
+template <typename T>
+class Span {
+ public:
+  Span(T *data, std::size_t size) : m_data_(data), m_size_(size) {
+  }
+  T *data() const {
+    return m_data_;
+  }
+  std::size_t size() const {
+    return m_size_;
+  }
+  T *begin() const {
+    return m_data_;
+  }
+  T *end() const {
+    return m_data_ + m_size_;
+  }
+
+ private:
+  T *m_data_;
+  std::size_t m_size_;
+};
+
+enum SpanKind {
+  SPAN_HEAD = 0,
+  SPAN_BODY,
+  SPAN_TAIL
+};
+
+/**
+ * Итератор по элементам, как в основном примере.
+ */
+template <typename T, typename U>
+class Iterator {
+ public:
+  typedef typename U::Storage::iterator iter_type;
+  Iterator(U *p_data) : m_p_data_(p_data), m_position_(0) {
+  }
+
+  void First() {
+    m_position_ = 0;
+  }
+
+  void Next() {
+    m_position_++;
+  }
+
+  bool IsDone() {
+    return m_position_ >= m_p_data_->m_data_.size();
+  }
+
+  iter_type Current() {
+    return m_p_data_->m_data_.begin() + m_position_;
+  }
+
+ private:
+  U *m_p_data_;
+  typename U::Storage::size_type m_position_;
+};
+
+/**
+ * Пакетный итератор с тем же протоколом First/Next/IsDone. Обходит элементы,
+ * начиная с first. Current отдаёт кусок, а kind() — его роль. Пустые голова
+ * и хвост пропускаются. Все куски тела, кроме, возможно, последнего,
+ * содержат batch_size элементов, и длина каждого кратна
+ * kSimdAlignment / sizeof(T).
+ */
+template <typename T, typename U>
+class BatchIterator {
+ public:
+  BatchIterator(U *p_data, std::size_t batch_size, std::size_t first = 0)
+      : m_p_data_(p_data), m_batch_size_(batch_size) {
+    std::size_t lane = kSimdAlignment % sizeof(T) == 0 ? kSimdAlignment / sizeof(T) : 1;
+    m_batch_size_ = std::max(lane, m_batch_size_ / lane * lane);
+    std::size_t size = m_p_data_->m_data_.size();
+    m_first_ = std::min(first, size);
+    std::uintptr_t address = reinterpret_cast<std::uintptr_t>(m_p_data_->m_data_.data() + m_first_);
+    std::size_t head = (kSimdAlignment - address % kSimdAlignment) % kSimdAlignment / sizeof(T);
+    m_body_begin_ = m_first_ + (lane == 1 ? 0 : std::min(size - m_first_, head));
+    m_body_end_ = m_body_begin_ + (size - m_body_begin_) / lane * lane;
+    First();
+  }
+
+  void First() {
+    m_begin_ = m_first_;
+    SetCurrent();
+  }
+
+  void Next() {
+    m_begin_ = m_end_;
+    SetCurrent();
+  }
+
+  bool IsDone() {
+    return m_begin_ >= m_p_data_->m_data_.size();
+  }
+
+  Span<T> Current() {
+    return Span<T>(m_p_data_->m_data_.data() + m_begin_, m_end_ - m_begin_);
+  }
+
+  SpanKind kind() const {
+    return m_kind_;
+  }
+
+ private:
+  void SetCurrent() {
+    if (m_begin_ < m_body_begin_) {
+      m_kind_ = SPAN_HEAD;
+      m_end_ = m_body_begin_;
+    } else if (m_begin_ < m_body_end_) {
+      m_kind_ = SPAN_BODY;
+      m_end_ = std::min(m_begin_ + m_batch_size_, m_body_end_);
+    } else {
+      m_kind_ = SPAN_TAIL;
+      m_end_ = m_p_data_->m_data_.size();
+    }
+  }
+
+  U *m_p_data_;
+  std::size_t m_batch_size_;
+  std::size_t m_first_;
+  std::size_t m_body_begin_;
+  std::size_t m_body_end_;
+  std::size_t m_begin_;
+  std::size_t m_end_;
+  SpanKind m_kind_;
+};
+
+/**
+ * Элементы хранятся с выравниванием на kSimdAlignment, поэтому голова есть
+ * только у обхода, который начинается не с первого элемента.
+ */
+template <class T>
+class Container {
+  friend class Iterator<T, Container>;
+  friend class BatchIterator<T, Container>;
+
+ public:
+  typedef std::vector<T, AlignedAllocator<T> > Storage;
+
+  void Add(T a) {
+    m_data_.push_back(a);
+  }
+
+  Iterator<T, Container> CreateIterator() {
+    return Iterator<T, Container>(this);
+  }
+
+  BatchIterator<T, Container> CreateBatchIterator(std::size_t batch_size = 1024, std::size_t first = 0) {
+    return BatchIterator<T, Container>(this, batch_size, first);
+  }
+
+ private:
+  Storage m_data_;
+};
+
+struct MinMax {
+  int min;
+  int max;
+};
+
+/**
+ * Скалярные ядра. Годятся для любого куска и используются для головы и
+ * хвоста, а также на процессорах без SSE2/AVX2.
+ */
+long long SumScalar(const int *data, std::size_t size) {
+  long long sum = 0;
+  for (std::size_t i = 0; i < size; i++) {
+    sum += data[i];
+  }
+  return sum;
+}
+
+void MinMaxScalar(const int *data, std::size_t size, MinMax *result) {
+  int low = result->min;
+  int high = result->max;
+  for (std::size_t i = 0; i < size; i++) {
+    low = std::min(low, data[i]);
+    high = std::max(high, data[i]);
+  }
+  result->min = low;
+  result->max = high;
+}
+
+#ifdef BATCH_X86_KERNELS
+/**
+ * Ядра SSE2. data выровнен на 16 байт, size кратен 4. В SSE2 нет
+ * расширения int32 -> int64 и min/max для int32, поэтому они собраны из
+ * сдвигов, сравнений и масок.
+ */
+__attribute__((target("sse2"))) long long SumSse2(const int *data, std::size_t size) {
+  __m128i acc = _mm_setzero_si128();
+  for (std::size_t i = 0; i < size; i += 4) {
+    __m128i v = _mm_load_si128(reinterpret_cast<const __m128i *>(data + i));
+    __m128i sign = _mm_srai_epi32(v, 31);
+    acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(v, sign));
+    acc = _mm_add_epi64(acc, _mm_unpackhi_epi32(v, sign));
+  }
+  long long lanes[2];
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes), acc);
+  return lanes[0] + lanes[1];
+}
+
+__attribute__((target("sse2"))) void MinMaxSse2(const int *data, std::size_t size, MinMax *result) {
+  __m128i low = _mm_set1_epi32(result->min);
+  __m128i high = _mm_set1_epi32(result->max);
+  for (std::size_t i = 0; i < size; i += 4) {
+    __m128i v = _mm_load_si128(reinterpret_cast<const __m128i *>(data + i));
+    __m128i less = _mm_cmplt_epi32(v, low);
+    low = _mm_or_si128(_mm_and_si128(less, v), _mm_andnot_si128(less, low));
+    __m128i greater = _mm_cmpgt_epi32(v, high);
+    high = _mm_or_si128(_mm_and_si128(greater, v), _mm_andnot_si128(greater, high));
+  }
+  int lows[4], highs[4];
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(lows), low);
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(highs), high);
+  result->min = *std::min_element(lows, lows + 4);
+  result->max = *std::max_element(highs, highs + 4);
+}
+
+/**
+ * Ядра AVX2. data выровнен на 32 байта, size кратен 8.
+ */
+__attribute__((target("avx2"))) long long SumAvx2(const int *data, std::size_t size) {
+  __m256i acc = _mm256_setzero_si256();
+  for (std::size_t i = 0; i < size; i += 8) {
+    __m256i v = _mm256_load_si256(reinterpret_cast<const __m256i *>(data + i));
+    acc = _mm256_add_epi64(acc, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v)));
+    acc = _mm256_add_epi64(acc, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v, 1)));
+  }
+  long long lanes[4];
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes), acc);
+  return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+__attribute__((target("avx2"))) void MinMaxAvx2(const int *data, std::size_t size, MinMax *result) {
+  __m256i low = _mm256_set1_epi32(result->min);
+  __m256i high = _mm256_set1_epi32(result->max);
+  for (std::size_t i = 0; i < size; i += 8) {
+    __m256i v = _mm256_load_si256(reinterpret_cast<const __m256i *>(data + i));
+    low = _mm256_min_epi32(low, v);
+    high = _mm256_max_epi32(high, v);
+  }
+  int lows[8], highs[8];
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(lows), low);
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(highs), high);
+  result->min = *std::min_element(lows, lows + 8);
+  result->max = *std::max_element(highs, highs + 8);
+}
+#endif  // BATCH_X86_KERNELS
+
+/**
+ * Набор ядер для тела. Выбирается один раз при запуске.
+ */
+struct Kernels {
+  const char *name;
+  long long (*sum)(const int *, std::size_t);
+  void (*min_max)(const int *, std::size_t, MinMax *);
+};
+
+const Kernels kScalarKernels = {"scalar", SumScalar, MinMaxScalar};
+#ifdef BATCH_X86_KERNELS
+const Kernels kSse2Kernels = {"sse2", SumSse2, MinMaxSse2};
+const Kernels kAvx2Kernels = {"avx2", SumAvx2, MinMaxAvx2};
+#endif
+
+/**
+ * Все ядра, которые поддерживает процессор, от медленного к быстрому.
+ */
+std::vector<const Kernels *> SupportedKernels() {
+  std::vector<const Kernels *> kernels;
+  kernels.push_back(&kScalarKernels);
+#ifdef BATCH_X86_KERNELS
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("sse2")) {
+    kernels.push_back(&kSse2Kernels);
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    kernels.push_back(&kAvx2Kernels);
+  }
+#endif
+  return kernels;
+}
+
+const Kernels &SelectKernels() {
+  return *SupportedKernels().back();
+}
+
+long long Sum(Container<int> &cont, const Kernels &kernels) {
+  long long sum = 0;
+  BatchIterator<int, Container<int> > it = cont.CreateBatchIterator();
+  for (it.First(); !it.IsDone(); it.Next()) {
+    Span<int> span = it.Current();
+    if (it.kind() == SPAN_BODY) {
+      sum += kernels.sum(span.data(), span.size());
+    } else {
+      sum += SumScalar(span.data(), span.size());
+    }
+  }
+  return sum;
+}
+
+MinMax FindMinMax(Container<int> &cont, const Kernels &kernels) {
+  MinMax result = {INT_MAX, INT_MIN};
+  BatchIterator<int, Container<int> > it = cont.CreateBatchIterator();
+  for (it.First(); !it.IsDone(); it.Next()) {
+    Span<int> span = it.Current();
+    if (it.kind() == SPAN_BODY) {
+      kernels.min_max(span.data(), span.size(), &result);
+    } else {
+      MinMaxScalar(span.data(), span.size(), &result);
+    }
+  }
+  return result;
+}
+
+void ClientCode(const Kernels &kernels) {
+  Container<int> cont;
+  for (int i = 0; i < 44; i++) {
+    cont.Add(i * 7 % 44 - 22);
+  }
+
+  // Обход со второго элемента: первый кусок не выровнен, и видны все три
+  // вида кусков.
+  std::cout << "Spans of elements 1..43 of a 44-element Container<int> with batch size 16:\n";
+  const char *kKindNames[] = {"head", "body", "tail"};
+  BatchIterator<int, Container<int> > it = cont.CreateBatchIterator(16, 1);
+  for (it.First(); !it.IsDone(); it.Next()) {
+    std::cout << "  " << kKindNames[it.kind()] << ": " << it.Current().size() << " elements\n";
+  }
+
+  MinMax min_max = FindMinMax(cont, kernels);
+  std::cout << "sum = " << Sum(cont, kernels) << ", min = " << min_max.min << ", max = " << min_max.max << "\n\n";
+}
+
+/**
+ * Вариант «по одному элементу» для сравнения.
+ */
+__attribute__((noinline)) long long SumPerElement(Container<int> &cont) {
+  long long sum = 0;
+  Iterator<int, Container<int> > it = cont.CreateIterator();
+  for (it.First(); !it.IsDone(); it.Next()) {
+    sum += *it.Current();
+  }
+  return sum;
+}
+
+__attribute__((noinline)) MinMax MinMaxPerElement(Container<int> &cont) {
+  MinMax result = {INT_MAX, INT_MIN};
+  Iterator<int, Container<int> > it = cont.CreateIterator();
+  for (it.First(); !it.IsDone(); it.Next()) {
+    result.min = std::min(result.min, *it.Current());
+    result.max = std::max(result.max, *it.Current());
+  }
+  return result;
+}
+
+template <typename F>
+void Measure(const char *name, F body, std::size_t elements, int rounds) {
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  long long check = 0;
+  for (int r = 0; r < rounds; r++) {
+    check += body();
+    // Не даёт компилятору вынести повторные обходы того же контейнера из цикла.
+    __asm__ __volatile__("" : : : "memory");
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::cout << name << elements * rounds / seconds / 1e9 << " G elements/s (check " << check << ")\n";
+}
+
+void Benchmark(std::size_t elements, const Kernels &best) {
+  const int kRounds = static_cast<int>((std::size_t(1) << 28) / elements + 1);
+  Container<int> cont;
+  for (std::size_t i = 0; i < elements; i++) {
+    cont.Add(static_cast<int>(i * 2654435761u % 2001) - 1000);
+  }
+  std::vector<const Kernels *> candidates = SupportedKernels();
+
+  std::cout << "Benchmark: " << elements << " ints x " << kRounds << " rounds, dispatch picked " << best.name << "\n";
+  Measure("sum, per element:       ", [&] { return SumPerElement(cont); }, elements, kRounds);
+  for (std::size_t i = 0; i < candidates.size(); i++) {
+    std::cout << "sum, batch " << candidates[i]->name << ": ";
+    Measure("", [&] { return Sum(cont, *candidates[i]); }, elements, kRounds);
+  }
+  Measure("min/max, per element:   ", [&] {
+    MinMax m = MinMaxPerElement(cont);
+    return static_cast<long long>(m.max) - m.min;
+  }, elements, kRounds);
+  for (std::size_t i = 0; i < candidates.size(); i++) {
+    std::cout << "min/max, batch " << candidates[i]->name << ": ";
+    Measure("", [&] {
+      MinMax m = FindMinMax(cont, *candidates[i]);
+      return static_cast<long long>(m.max) - m.min;
+    }, elements, kRounds);
+  }
+}
+
+int main(int argc, char *argv[]) {
+  const Kernels &kernels = SelectKernels();
+  ClientCode(kernels);
+  // По умолчанию контейнер помещается в кэш L2, как в примере Benchmark.
+  std::size_t elements = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : (1u << 14);
+  Benchmark(elements, kernels);
+  return 0;
+}
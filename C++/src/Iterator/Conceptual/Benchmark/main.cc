@@ -0,0 +1,194 @@
+/**
+ * Паттерн Итератор
+ *
+ * Назначение: Даёт возможность последовательно обходить элементы составных
+ * объектов, не раскрывая их внутреннего представления.
+ *
+ * Этот пример сравнивает скорость обхода Container<int> тремя способами:
+ * старым протоколом с итератором в куче, тем же протоколом с итератором-
+ * значением и итераторами begin/end в стиле STL. Цикл по begin/end всегда
+ * виден компилятору как простой цикл по непрерывной памяти; протокол
+ * First/Next/IsDone векторизуется, только если все его вызовы встроились.
+ * Результаты стоит сравнить при -O2 и -O3.
+ */
+
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <numeric>
+#include <vector>
+
+template <typename T, typename U>
+class Iterator {
+ public:
+  typedef typename std::vector<T>::iterator iter_type;
+  Iterator(U *p_data, bool reverse = false) : m_p_data_(p_data), m_reverse_(reverse), m_position_(0) {
+  }
+
+  void First() {
+    m_position_ = 0;
+  }
+
+  void Next() {
+    m_position_++;
+  }
+
+  bool IsDone() {
+    return m_position_ >= m_p_data_->m_data_.size();
+  }
+
+  iter_type Current() {
+    if (m_reverse_) {
+      return m_p_data_->m_data_.end() - 1 - m_position_;
+    }
+    return m_p_data_->m_data_.begin() + m_position_;
+  }
+
+ private:
+  U *m_p_data_;
+  bool m_reverse_;
+  typename std::vector<T>::size_type m_position_;
+};
+
+/**
+ * Итератор в том виде, в каком он был раньше: создаётся в куче и хранит
+ * итератор вектора. Оставлен только для сравнения.
+ */
+template <typename T, typename U>
+class HeapIterator {
+ public:
+  typedef typename std::vector<T>::iterator iter_type;
+  explicit HeapIterator(U *p_data) : m_p_data_(p_data) {
+    m_it_ = m_p_data_->m_data_.begin();
+  }
+
+  void First() {
+    m_it_ = m_p_data_->m_data_.begin();
+  }
+
+  void Next() {
+    m_it_++;
+  }
+
+  bool IsDone() {
+    return (m_it_ == m_p_data_->m_data_.end());
+  }
+
+  iter_type Current() {
+    return m_it_;
+  }
+
+ private:
+  U *m_p_data_;
+  iter_type m_it_;
+};
+
+template <class T>
+class Container {
+  friend class Iterator<T, Container>;
+  friend class HeapIterator<T, Container>;
+
+ public:
+  typedef typename std::vector<T>::iterator iterator;
+  typedef typename std::vector<T>::const_iterator const_iterator;
+
+  void Add(T a) {
+    m_data_.push_back(a);
+  }
+
+  Iterator<T, Container> CreateIterator(bool reverse = false) {
+    return Iterator<T, Container>(this, reverse);
+  }
+
+  HeapIterator<T, Container> *CreateHeapIterator() {
+    return new HeapIterator<T, Container>(this);
+  }
+
+  iterator begin() {
+    return m_data_.begin();
+  }
+  iterator end() {
+    return m_data_.end();
+  }
+  const_iterator begin() const {
+    return m_data_.begin();
+  }
+  const_iterator end() const {
+    return m_data_.end();
+  }
+
+ private:
+  std::vector<T> m_data_;
+};
+
+/**
+ * Каждая функция суммирует контейнер rounds раз. noinline не даёт
+ * компилятору объединить циклы разных способов обхода.
+ */
+__attribute__((noinline)) long long SumHeapProtocol(Container<int> &cont, int rounds) {
+  long long sum = 0;
+  for (int r = 0; r < rounds; r++) {
+    HeapIterator<int, Container<int> > *it = cont.CreateHeapIterator();
+    for (it->First(); !it->IsDone(); it->Next()) {
+      sum += *it->Current();
+    }
+    delete it;
+  }
+  return sum;
+}
+
+__attribute__((noinline)) long long SumValueProtocol(Container<int> &cont, int rounds) {
+  long long sum = 0;
+  for (int r = 0; r < rounds; r++) {
+    Iterator<int, Container<int> > it = cont.CreateIterator();
+    for (it.First(); !it.IsDone(); it.Next()) {
+      sum += *it.Current();
+    }
+  }
+  return sum;
+}
+
+__attribute__((noinline)) long long SumRangeFor(const Container<int> &cont, int rounds) {
+  long long sum = 0;
+  for (int r = 0; r < rounds; r++) {
+    for (int value : cont) {
+      sum += value;
+    }
+  }
+  return sum;
+}
+
+__attribute__((noinline)) long long SumAccumulate(const Container<int> &cont, int rounds) {
+  long long sum = 0;
+  for (int r = 0; r < rounds; r++) {
+    sum = std::accumulate(cont.begin(), cont.end(), sum);
+  }
+  return sum;
+}
+
+template <typename F>
+void Measure(const char *name, F sum, std::size_t elements, int rounds) {
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  long long result = sum();
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::cout << name << elements * rounds / seconds / 1e9 << " G elements/s (sum " << result << ")\n";
+}
+
+int main(int argc, char *argv[]) {
+  // По умолчанию контейнер помещается в кэш L2, чтобы измерять сам обход, а
+  // не пропускную способность памяти.
+  std::size_t elements = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : (1u << 14);
+  const int kRounds = static_cast<int>((std::size_t(1) << 28) / elements + 1);
+  Container<int> cont;
+  for (std::size_t i = 0; i < elements; i++) {
+    cont.Add(static_cast<int>(i & 0xff));
+  }
+
+  std::cout << "Summing Container<int> of " << elements << " elements " << kRounds << " times\n";
+  Measure("First/Next/IsDone, heap iterator:  ", [&] { return SumHeapProtocol(cont, kRounds); }, elements, kRounds);
+  Measure("First/Next/IsDone, value iterator: ", [&] { return SumValueProtocol(cont, kRounds); }, elements, kRounds);
+  Measure("range-for over begin()/end():      ", [&] { return SumRangeFor(cont, kRounds); }, elements, kRounds);
+  Measure("std::accumulate(begin(), end()):   ", [&] { return SumAccumulate(cont, kRounds); }, elements, kRounds);
+  return 0;
+}
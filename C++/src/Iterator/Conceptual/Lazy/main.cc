@@ -0,0 +1,476 @@
+/**
+ * Паттерн Итератор
+ *
+ * Назначение: Даёт возможность последовательно обходить элементы составных
+ * объектов, не раскрывая их внутреннего представления.
+ *
+ * Этот вариант показывает ленивые адаптеры итераторов: Filter, Map, Take и
+ * Zip. Каждый адаптер — это представление поверх итераторов коллекции,
+ * которое ничего не вычисляет заранее. Цепочка адаптеров сливается в один
+ * проход по данным без промежуточных контейнеров.
+ */
+
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+template <class T>
+class Container {
+ public:
+  typedef typename std::vector<T>::iterator iterator;
+  typedef typename std::vector<T>::const_iterator const_iterator;
+
+  void Add(T a) {
+    m_data_.push_back(a);
+  }
+
+  void Reserve(std::size_t size) {
+    m_data_.reserve(size);
+  }
+
+  std::size_t size() const {
+    return m_data_.size();
+  }
+
+  iterator begin() {
+    return m_data_.begin();
+  }
+  iterator end() {
+    return m_data_.end();
+  }
+  const_iterator begin() const {
+    return m_data_.begin();
+  }
+  const_iterator end() const {
+    return m_data_.end();
+  }
+
+ private:
+  std::vector<T> m_data_;
+};
+
+class Data {
+ public:
+  Data(int a = 0) : m_data_(a) {}
+
+  void set_data(int a) {
+    m_data_ = a;
+  }
+
+  int data() const {
+    return m_data_;
+  }
+
+ private:
+  int m_data_;
+};
+
+/**
+ * Общий базовый класс всех представлений. По нему оператор | отличает
+ * представление (его копируют, это дёшево) от коллекции (на неё ссылаются).
+ */
+class View {};
+
+/**
+ * Представление, ссылающееся на коллекцию. Коллекция должна жить дольше
+ * представления.
+ */
+template <typename C>
+class RefView : public View {
+ public:
+  typedef decltype(std::declval<C &>().begin()) iterator;
+
+  explicit RefView(C *collection) : m_collection_(collection) {
+  }
+  iterator begin() const {
+    return m_collection_->begin();
+  }
+  iterator end() const {
+    return m_collection_->end();
+  }
+
+ private:
+  C *m_collection_;
+};
+
+template <typename V, typename Enable = void>
+struct AsView {
+  typedef RefView<typename std::remove_reference<V>::type> type;
+  static type Make(V &collection) {
+    return type(&collection);
+  }
+};
+
+template <typename V>
+struct AsView<V, typename std::enable_if<std::is_base_of<View, typename std::decay<V>::type>::value>::type> {
+  typedef typename std::decay<V>::type type;
+  static type Make(const type &view) {
+    return view;
+  }
+};
+
+/**
+ * Filter пропускает элементы, для которых предикат ложен. Итератор хранит
+ * конец базового диапазона, чтобы знать, где остановить поиск.
+ */
+template <typename Base, typename Predicate>
+class FilterView : public View {
+ public:
+  typedef typename Base::iterator BaseIterator;
+
+  class iterator {
+   public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef typename std::iterator_traits<BaseIterator>::value_type value_type;
+    typedef typename std::iterator_traits<BaseIterator>::difference_type difference_type;
+    typedef typename std::iterator_traits<BaseIterator>::pointer pointer;
+    typedef typename std::iterator_traits<BaseIterator>::reference reference;
+
+    iterator(BaseIterator it, BaseIterator end, const Predicate *predicate)
+        : m_it_(it), m_end_(end), m_predicate_(predicate) {
+      SkipRejected();
+    }
+    reference operator*() const {
+      return *m_it_;
+    }
+    iterator &operator++() {
+      ++m_it_;
+      SkipRejected();
+      return *this;
+    }
+    bool operator==(const iterator &other) const {
+      return m_it_ == other.m_it_;
+    }
+    bool operator!=(const iterator &other) const {
+      return m_it_ != other.m_it_;
+    }
+
+   private:
+    void SkipRejected() {
+      while (m_it_ != m_end_ && !(*m_predicate_)(*m_it_)) {
+        ++m_it_;
+      }
+    }
+    BaseIterator m_it_;
+    BaseIterator m_end_;
+    const Predicate *m_predicate_;
+  };
+
+  FilterView(Base base, Predicate predicate) : m_base_(base), m_predicate_(predicate) {
+  }
+  iterator begin() const {
+    return iterator(m_base_.begin(), m_base_.end(), &m_predicate_);
+  }
+  iterator end() const {
+    return iterator(m_base_.end(), m_base_.end(), &m_predicate_);
+  }
+
+ private:
+  Base m_base_;
+  Predicate m_predicate_;
+};
+
+/**
+ * Map применяет функцию к элементу в момент разыменования итератора.
+ */
+template <typename Base, typename Function>
+class MapView : public View {
+ public:
+  typedef typename Base::iterator BaseIterator;
+
+  class iterator {
+   public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef decltype(std::declval<const Function &>()(*std::declval<BaseIterator>())) reference;
+    typedef typename std::decay<reference>::type value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef void pointer;
+
+    iterator(BaseIterator it, const Function *function) : m_it_(it), m_function_(function) {
+    }
+    reference operator*() const {
+      return (*m_function_)(*m_it_);
+    }
+    iterator &operator++() {
+      ++m_it_;
+      return *this;
+    }
+    bool operator==(const iterator &other) const {
+      return m_it_ == other.m_it_;
+    }
+    bool operator!=(const iterator &other) const {
+      return m_it_ != other.m_it_;
+    }
+
+   private:
+    BaseIterator m_it_;
+    const Function *m_function_;
+  };
+
+  MapView(Base base, Function function) : m_base_(base), m_function_(function) {
+  }
+  iterator begin() const {
+    return iterator(m_base_.begin(), &m_function_);
+  }
+  iterator end() const {
+    return iterator(m_base_.end(), &m_function_);
+  }
+
+ private:
+  Base m_base_;
+  Function m_function_;
+};
+
+/**
+ * Take останавливает обход после count элементов. Итератор конца — это
+ * итератор с нулевым остатком, поэтому базовый диапазон дальше не читается.
+ */
+template <typename Base>
+class TakeView : public View {
+ public:
+  typedef typename Base::iterator BaseIterator;
+
+  class iterator {
+   public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef typename std::iterator_traits<BaseIterator>::value_type value_type;
+    typedef typename std::iterator_traits<BaseIterator>::difference_type difference_type;
+    typedef typename std::iterator_traits<BaseIterator>::pointer pointer;
+    typedef typename std::iterator_traits<BaseIterator>::reference reference;
+
+    iterator(BaseIterator it, std::size_t remaining) : m_it_(it), m_remaining_(remaining) {
+    }
+    reference operator*() const {
+      return *m_it_;
+    }
+    iterator &operator++() {
+      ++m_it_;
+      --m_remaining_;
+      return *this;
+    }
+    bool operator==(const iterator &other) const {
+      return (m_remaining_ == 0 && other.m_remaining_ == 0) || m_it_ == other.m_it_;
+    }
+    bool operator!=(const iterator &other) const {
+      return !(*this == other);
+    }
+
+   private:
+    BaseIterator m_it_;
+    std::size_t m_remaining_;
+  };
+
+  TakeView(Base base, std::size_t count) : m_base_(base), m_count_(count) {
+  }
+  iterator begin() const {
+    return iterator(m_base_.begin(), m_count_);
+  }
+  iterator end() const {
+    return iterator(m_base_.end(), 0);
+  }
+
+ private:
+  Base m_base_;
+  std::size_t m_count_;
+};
+
+/**
+ * Zip обходит два диапазона одновременно и останавливается на конце более
+ * короткого. Элемент — пара ссылок (или значений) из обоих диапазонов.
+ */
+template <typename First, typename Second>
+class ZipView : public View {
+ public:
+  typedef typename First::iterator FirstIterator;
+  typedef typename Second::iterator SecondIterator;
+
+  class iterator {
+   public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef std::pair<decltype(*std::declval<FirstIterator>()), decltype(*std::declval<SecondIterator>())>
+        value_type;
+    typedef value_type reference;
+    typedef std::ptrdiff_t difference_type;
+    typedef void pointer;
+
+    iterator(FirstIterator first, SecondIterator second) : m_first_(first), m_second_(second) {
+    }
+    reference operator*() const {
+      return reference(*m_first_, *m_second_);
+    }
+    iterator &operator++() {
+      ++m_first_;
+      ++m_second_;
+      return *this;
+    }
+    bool operator==(const iterator &other) const {
+      return m_first_ == other.m_first_ || m_second_ == other.m_second_;
+    }
+    bool operator!=(const iterator &other) const {
+      return !(*this == other);
+    }
+
+   private:
+    FirstIterator m_first_;
+    SecondIterator m_second_;
+  };
+
+  ZipView(First first, Second second) : m_first_(first), m_second_(second) {
+  }
+  iterator begin() const {
+    return iterator(m_first_.begin(), m_second_.begin());
+  }
+  iterator end() const {
+    return iterator(m_first_.end(), m_second_.end());
+  }
+
+ private:
+  First m_first_;
+  Second m_second_;
+};
+
+/**
+ * Синтаксис конвейера: cont | Filter(p) | Map(f) | Take(n).
+ */
+template <typename Predicate>
+struct FilterAdaptor {
+  Predicate predicate;
+};
+template <typename Function>
+struct MapAdaptor {
+  Function function;
+};
+struct TakeAdaptor {
+  std::size_t count;
+};
+
+template <typename Predicate>
+FilterAdaptor<Predicate> Filter(Predicate predicate) {
+  FilterAdaptor<Predicate> adaptor = {predicate};
+  return adaptor;
+}
+template <typename Function>
+MapAdaptor<Function> Map(Function function) {
+  MapAdaptor<Function> adaptor = {function};
+  return adaptor;
+}
+inline TakeAdaptor Take(std::size_t count) {
+  TakeAdaptor adaptor = {count};
+  return adaptor;
+}
+
+template <typename V, typename Predicate>
+FilterView<typename AsView<V>::type, Predicate> operator|(V &&source, const FilterAdaptor<Predicate> &adaptor) {
+  return FilterView<typename AsView<V>::type, Predicate>(AsView<V>::Make(source), adaptor.predicate);
+}
+template <typename V, typename Function>
+MapView<typename AsView<V>::type, Function> operator|(V &&source, const MapAdaptor<Function> &adaptor) {
+  return MapView<typename AsView<V>::type, Function>(AsView<V>::Make(source), adaptor.function);
+}
+template <typename V>
+TakeView<typename AsView<V>::type> operator|(V &&source, const TakeAdaptor &adaptor) {
+  return TakeView<typename AsView<V>::type>(AsView<V>::Make(source), adaptor.count);
+}
+template <typename A, typename B>
+ZipView<typename AsView<A>::type, typename AsView<B>::type> Zip(A &&first, B &&second) {
+  return ZipView<typename AsView<A>::type, typename AsView<B>::type>(AsView<A>::Make(first),
+                                                                     AsView<B>::Make(second));
+}
+
+bool IsMultipleOfThree(const Data &d) {
+  return d.data() % 3 == 0;
+}
+
+struct Doubled {
+  long long operator()(const Data &d) const {
+    return 2LL * d.data();
+  }
+};
+
+void ClientCode() {
+  Container<Data> cont;
+  for (int i = 0; i < 20; i++) {
+    cont.Add(Data(i));
+  }
+
+  std::cout << "First 4 doubled multiples of three:";
+  for (long long value : cont | Filter(IsMultipleOfThree) | Map(Doubled()) | Take(4)) {
+    std::cout << " " << value;
+  }
+  std::cout << "\n";
+
+  Container<int> weights;
+  weights.Add(10);
+  weights.Add(20);
+  weights.Add(30);
+  std::cout << "Zip with weights:";
+  for (std::pair<Data &, int &> item : Zip(cont, weights)) {
+    std::cout << " " << item.first.data() << "*" << item.second;
+  }
+  std::cout << "\n\n";
+}
+
+/**
+ * Та же задача, решённая «в лоб»: каждый шаг создаёт новый контейнер.
+ */
+long long EagerPipeline(const Container<Data> &cont, std::size_t take) {
+  Container<Data> filtered;
+  for (Container<Data>::const_iterator it = cont.begin(); it != cont.end(); ++it) {
+    if (IsMultipleOfThree(*it)) {
+      filtered.Add(*it);
+    }
+  }
+  Container<long long> mapped;
+  for (Container<Data>::const_iterator it = filtered.begin(); it != filtered.end(); ++it) {
+    mapped.Add(Doubled()(*it));
+  }
+  Container<long long> taken;
+  for (Container<long long>::const_iterator it = mapped.begin(); it != mapped.end() && taken.size() < take; ++it) {
+    taken.Add(*it);
+  }
+  long long sum = 0;
+  for (Container<long long>::const_iterator it = taken.begin(); it != taken.end(); ++it) {
+    sum += *it;
+  }
+  return sum;
+}
+
+long long LazyPipeline(const Container<Data> &cont, std::size_t take) {
+  long long sum = 0;
+  for (long long value : cont | Filter(IsMultipleOfThree) | Map(Doubled()) | Take(take)) {
+    sum += value;
+  }
+  return sum;
+}
+
+void Benchmark(std::size_t elements) {
+  Container<Data> cont;
+  cont.Reserve(elements);
+  for (std::size_t i = 0; i < elements; i++) {
+    cont.Add(Data(static_cast<int>(i % 1000)));
+  }
+  std::size_t takes[] = {elements, elements / 100};
+  std::cout << "Benchmark: filter/map/take over " << elements << " Data elements\n";
+  for (std::size_t t = 0; t < 2; t++) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    long long eager = EagerPipeline(cont, takes[t]);
+    double eager_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    start = std::chrono::steady_clock::now();
+    long long lazy = LazyPipeline(cont, takes[t]);
+    double lazy_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "take " << takes[t] << ": eager " << eager_ms << " ms, lazy " << lazy_ms << " ms"
+              << (eager == lazy ? "" : " (results differ!)") << "\n";
+  }
+}
+
+int main(int argc, char *argv[]) {
+  ClientCode();
+  std::size_t elements = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000000;
+  Benchmark(elements);
+  return 0;
+}
@@ -0,0 +1,272 @@
+/**
+ * Паттерн Итератор
+ *
+ * Назначение: Даёт возможность последовательно обходить элементы составных
+ * объектов, не раскрывая их внутреннего представления.
+ *
+ * Этот вариант добавляет коллекции делимый диапазон. Диапазон можно разбить
+ * на непересекающиеся куски, границы которых выровнены по строкам кэша, и
+ * раздать их рабочим потокам. Поверх этого построены параллельные
+ * for_each, reduce и transform.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+/**
+ * Размер строки кэша, по которой выравниваются границы кусков. Если два
+ * потока пишут в одну строку кэша, они мешают друг другу (false sharing).
+ */
+static const std::size_t kCacheLineSize = 64;
+
+/**
+ * Непрерывный диапазон элементов коллекции. Диапазон не владеет данными.
+ */
+template <typename T>
+class Range {
+ public:
+  Range(T *begin, T *end) : m_begin_(begin), m_end_(end) {
+  }
+
+  T *begin() const {
+    return m_begin_;
+  }
+  T *end() const {
+    return m_end_;
+  }
+  std::size_t size() const {
+    return static_cast<std::size_t>(m_end_ - m_begin_);
+  }
+  bool empty() const {
+    return m_begin_ == m_end_;
+  }
+
+  /**
+   * Сдвигает точку разбиения назад до ближайшего элемента, с которого
+   * начинается строка кэша. Для типов, размер которых не делит строку кэша,
+   * точка не сдвигается.
+   */
+  std::size_t AlignedSplitPoint(std::size_t index) const {
+    if (kCacheLineSize % sizeof(T) != 0 || index >= size()) {
+      return std::min(index, size());
+    }
+    std::uintptr_t address = reinterpret_cast<std::uintptr_t>(m_begin_);
+    std::size_t head = ((kCacheLineSize - address % kCacheLineSize) % kCacheLineSize) / sizeof(T);
+    if (index < head) {
+      return 0;
+    }
+    std::size_t per_line = kCacheLineSize / sizeof(T);
+    return head + (index - head) / per_line * per_line;
+  }
+
+  /**
+   * Делит диапазон примерно на parts равных кусков. Куски не пересекаются,
+   * вместе покрывают весь диапазон, а внутренние границы выровнены по
+   * строкам кэша: каждая граница округляется вниз, и остаток достаётся
+   * последнему куску. Пустые куски не возвращаются.
+   */
+  std::vector<Range> Split(std::size_t parts) const {
+    std::vector<Range> chunks;
+    if (parts == 0) {
+      parts = 1;
+    }
+    std::size_t start = 0;
+    for (std::size_t i = 1; i <= parts && start < size(); i++) {
+      std::size_t stop = i == parts ? size() : AlignedSplitPoint(size() / parts * i);
+      if (stop > start) {
+        chunks.push_back(Range(m_begin_ + start, m_begin_ + stop));
+        start = stop;
+      }
+    }
+    return chunks;
+  }
+
+ private:
+  T *m_begin_;
+  T *m_end_;
+};
+
+template <class T>
+class Container {
+ public:
+  typedef typename std::vector<T>::iterator iterator;
+  typedef typename std::vector<T>::const_iterator const_iterator;
+
+  explicit Container(std::size_t size = 0, const T &value = T()) : m_data_(size, value) {
+  }
+
+  void Add(T a) {
+    m_data_.push_back(a);
+  }
+
+  std::size_t size() const {
+    return m_data_.size();
+  }
+
+  iterator begin() {
+    return m_data_.begin();
+  }
+  iterator end() {
+    return m_data_.end();
+  }
+  const_iterator begin() const {
+    return m_data_.begin();
+  }
+  const_iterator end() const {
+    return m_data_.end();
+  }
+
+  Range<T> range() {
+    return Range<T>(m_data_.data(), m_data_.data() + m_data_.size());
+  }
+  Range<const T> range() const {
+    return Range<const T>(m_data_.data(), m_data_.data() + m_data_.size());
+  }
+
+ private:
+  std::vector<T> m_data_;
+};
+
+/**
+ * Запускает body для каждого куска в thread_count потоках. Кусков больше,
+ * чем потоков: поток, закончивший раньше, берёт следующий свободный кусок,
+ * поэтому неравномерная работа распределяется сама.
+ */
+template <typename T>
+void ForEachChunk(const Range<T> &range, unsigned thread_count,
+                  const std::function<void(std::size_t, const Range<T> &)> &body) {
+  if (thread_count == 0) {
+    thread_count = 1;
+  }
+  std::vector<Range<T> > chunks = range.Split(thread_count * 4);
+  std::atomic<std::size_t> next(0);
+  auto worker = [&] {
+    for (std::size_t i = next.fetch_add(1); i < chunks.size(); i = next.fetch_add(1)) {
+      body(i, chunks[i]);
+    }
+  };
+  std::vector<std::thread> threads;
+  for (unsigned t = 1; t < thread_count; t++) {
+    threads.push_back(std::thread(worker));
+  }
+  worker();
+  for (std::size_t i = 0; i < threads.size(); i++) {
+    threads[i].join();
+  }
+}
+
+template <typename T, typename F>
+void ParallelForEach(Range<T> range, F f, unsigned thread_count) {
+  ForEachChunk<T>(range, thread_count, [&f](std::size_t, const Range<T> &chunk) {
+    for (T *it = chunk.begin(); it != chunk.end(); ++it) {
+      f(*it);
+    }
+  });
+}
+
+/**
+ * Каждый кусок сворачивается отдельно, а частичные результаты объединяются
+ * в порядке кусков. Частичные результаты разделены отступом в строку кэша,
+ * чтобы потоки не писали в одну и ту же строку.
+ */
+template <typename T, typename R, typename Op>
+R ParallelReduce(Range<T> range, R init, Op op, unsigned thread_count) {
+  struct Partial {
+    R value;
+    bool used;
+    char padding[kCacheLineSize];
+  };
+  std::vector<Partial> partials(std::max(1u, thread_count) * 4, Partial());
+  ForEachChunk<T>(range, thread_count, [&](std::size_t index, const Range<T> &chunk) {
+    R value = *chunk.begin();
+    for (T *it = chunk.begin() + 1; it != chunk.end(); ++it) {
+      value = op(value, *it);
+    }
+    partials[index].value = value;
+    partials[index].used = true;
+  });
+  R result = init;
+  for (std::size_t i = 0; i < partials.size(); i++) {
+    if (partials[i].used) {
+      result = op(result, partials[i].value);
+    }
+  }
+  return result;
+}
+
+/**
+ * Записывает f(in[i]) в out[i]. Выходной диапазон должен быть не короче
+ * входного; границы кусков выбираются по входному диапазону.
+ */
+template <typename T, typename U, typename F>
+void ParallelTransform(Range<T> in, Range<U> out, F f, unsigned thread_count) {
+  ForEachChunk<T>(in, thread_count, [&](std::size_t, const Range<T> &chunk) {
+    U *target = out.begin() + (chunk.begin() - in.begin());
+    for (T *it = chunk.begin(); it != chunk.end(); ++it, ++target) {
+      *target = f(*it);
+    }
+  });
+}
+
+void ClientCode() {
+  Container<int> cont;
+  for (int i = 0; i < 100; i++) {
+    cont.Add(i);
+  }
+
+  std::cout << "Chunks of a 100-element Container<int> for 3 threads:\n";
+  std::vector<Range<int> > chunks = cont.range().Split(3);
+  for (std::size_t i = 0; i < chunks.size(); i++) {
+    std::cout << "  [" << *chunks[i].begin() << ", " << *(chunks[i].end() - 1) << "] " << chunks[i].size()
+              << " elements\n";
+  }
+
+  ParallelForEach(cont.range(), [](int &value) { value *= 2; }, 3);
+  long long sum = ParallelReduce(cont.range(), 0LL, [](long long a, long long b) { return a + b; }, 3);
+  std::cout << "Sum after doubling: " << sum << "\n";
+
+  Container<double> halves(cont.size());
+  ParallelTransform(cont.range(), halves.range(), [](int value) { return value / 4.0; }, 3);
+  std::cout << "halves[99] = " << *(halves.end() - 1) << "\n\n";
+}
+
+void Benchmark(std::size_t elements) {
+  Container<int> cont(elements, 1);
+  unsigned hardware_threads = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<unsigned> thread_counts;
+  for (unsigned t = 1; t < hardware_threads; t *= 2) {
+    thread_counts.push_back(t);
+  }
+  thread_counts.push_back(hardware_threads);
+
+  std::cout << "Benchmark: sum of " << elements << " ints, " << hardware_threads << " hardware threads\n";
+  double single_thread_seconds = 0;
+  for (std::size_t i = 0; i < thread_counts.size(); i++) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    long long sum = ParallelReduce(cont.range(), 0LL, [](long long a, long long b) { return a + b; },
+                                   thread_counts[i]);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (i == 0) {
+      single_thread_seconds = seconds;
+    }
+    std::cout << thread_counts[i] << " thread(s): " << seconds * 1e3 << " ms, " << elements / seconds / 1e9
+              << " G elements/s, speedup " << single_thread_seconds / seconds << "x (sum " << sum << ")\n";
+  }
+}
+
+int main(int argc, char *argv[]) {
+  ClientCode();
+  // 1e9 элементов занимают 4 ГБ; по умолчанию берём 2^26, размер можно
+  // передать первым аргументом, в том числе в виде 1e9.
+  std::size_t elements = argc > 1 ? static_cast<std::size_t>(std::strtod(argv[1], nullptr)) : (std::size_t(1) << 26);
+  Benchmark(elements);
+  return 0;
+}
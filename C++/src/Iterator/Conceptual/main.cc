@@ -5,7 +5,9 @@
  * объектов, не раскрывая их внутреннего представления.
  */
 
+#include <algorithm>
 #include <iostream>
+#include <numeric>
 #include <string>
 #include <vector>
 
@@ -14,38 +16,52 @@
  * generics containers defined by the standard library.
  */
 
+/**
+ * Итератор хранит позицию как индекс, поэтому обратный обход работает так же,
+ * как прямой, и никогда не выходит за начало вектора. Итератор — обычный
+ * объект-значение: коллекция возвращает его по значению, и освобождать его
+ * не нужно.
+ */
 template <typename T, typename U>
 class Iterator {
  public:
   typedef typename std::vector<T>::iterator iter_type;
-  Iterator(U *p_data, bool reverse = false) : m_p_data_(p_data) {
-    m_it_ = m_p_data_->m_data_.begin();
+  Iterator(U *p_data, bool reverse = false) : m_p_data_(p_data), m_reverse_(reverse), m_position_(0) {
   }
 
   void First() {
-    m_it_ = m_p_data_->m_data_.begin();
+    m_position_ = 0;
   }
 
   void Next() {
-    m_it_++;
+    m_position_++;
   }
 
   bool IsDone() {
-    return (m_it_ == m_p_data_->m_data_.end());
+    return m_position_ >= m_p_data_->m_data_.size();
   }
 
   iter_type Current() {
-    return m_it_;
+    if (m_reverse_) {
+      return m_p_data_->m_data_.end() - 1 - m_position_;
+    }
+    return m_p_data_->m_data_.begin() + m_position_;
   }
 
  private:
   U *m_p_data_;
-  iter_type m_it_;
+  bool m_reverse_;
+  typename std::vector<T>::size_type m_position_;
 };
 
 /**
  * Конкретные Коллекции предоставляют один или несколько методов для получения
  * новых экземпляров итератора, совместимых с классом коллекции.
+ *
+ * Кроме собственного протокола First/Next/IsDone коллекция отдаёт итераторы
+ * произвольного доступа в стиле STL (begin/end и rbegin/rend). С ними
+ * работают range-for и алгоритмы из <algorithm>, а компилятор видит
+ * обычный цикл по непрерывной памяти и может его векторизовать.
  */
 
 template <class T>
@@ -53,12 +69,42 @@ class Container {
   friend class Iterator<T, Container>;
 
  public:
+  typedef typename std::vector<T>::iterator iterator;
+  typedef typename std::vector<T>::const_iterator const_iterator;
+  typedef typename std::vector<T>::reverse_iterator reverse_iterator;
+  typedef typename std::vector<T>::const_reverse_iterator const_reverse_iterator;
+
   void Add(T a) {
     m_data_.push_back(a);
   }
 
-  Iterator<T, Container> *CreateIterator() {
-    return new Iterator<T, Container>(this);
+  Iterator<T, Container> CreateIterator(bool reverse = false) {
+    return Iterator<T, Container>(this, reverse);
+  }
+
+  iterator begin() {
+    return m_data_.begin();
+  }
+  iterator end() {
+    return m_data_.end();
+  }
+  const_iterator begin() const {
+    return m_data_.begin();
+  }
+  const_iterator end() const {
+    return m_data_.end();
+  }
+  reverse_iterator rbegin() {
+    return m_data_.rbegin();
+  }
+  reverse_iterator rend() {
+    return m_data_.rend();
+  }
+  const_reverse_iterator rbegin() const {
+    return m_data_.rbegin();
+  }
+  const_reverse_iterator rend() const {
+    return m_data_.rend();
   }
 
  private:
@@ -94,9 +140,9 @@ void ClientCode() {
     cont.Add(i);
   }
 
-  Iterator<int, Container<int>> *it = cont.CreateIterator();
-  for (it->First(); !it->IsDone(); it->Next()) {
-    std::cout << *it->Current() << std::endl;
+  Iterator<int, Container<int>> it = cont.CreateIterator();
+  for (it.First(); !it.IsDone(); it.Next()) {
+    std::cout << *it.Current() << std::endl;
   }
 
   Container<Data> cont2;
@@ -106,10 +152,24 @@ void ClientCode() {
   cont2.Add(c);
 
   std::cout << "________________Iterator with custom Class______________________________" << std::endl;
-  Iterator<Data, Container<Data>> *it2 = cont2.CreateIterator();
-  for (it2->First(); !it2->IsDone(); it2->Next()) {
-    std::cout << it2->Current()->data() << std::endl;
+  Iterator<Data, Container<Data>> it2 = cont2.CreateIterator();
+  for (it2.First(); !it2.IsDone(); it2.Next()) {
+    std::cout << it2.Current()->data() << std::endl;
+  }
+
+  std::cout << "________________Reverse iterator with custom Class______________________" << std::endl;
+  Iterator<Data, Container<Data>> it3 = cont2.CreateIterator(true);
+  for (it3.First(); !it3.IsDone(); it3.Next()) {
+    std::cout << it3.Current()->data() << std::endl;
+  }
+
+  std::cout << "________________Range-for and <algorithm> with int_____________________" << std::endl;
+  std::reverse(cont.begin(), cont.end());
+  for (int value : cont) {
+    std::cout << value << " ";
   }
+  std::cout << std::endl;
+  std::cout << "sum = " << std::accumulate(cont.begin(), cont.end(), 0) << std::endl;
 }
 
 int main() {
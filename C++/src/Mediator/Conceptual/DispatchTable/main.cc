@@ -0,0 +1,328 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+/**
+ * Паттерн Посредник
+ *
+ * Назначение: Позволяет уменьшить связанность множества классов между собой,
+ * благодаря перемещению этих связей в один класс-посредник.
+ *
+ * В основном примере событие — строка, которую Notify получает по значению
+ * и сравнивает со всеми известными событиями. Здесь имена событий один раз
+ * превращаются в небольшие целые идентификаторы, а посредник хранит таблицу
+ * «(вид отправителя, событие) -> список обработчиков». Уведомление — это
+ * одно обращение к таблице по индексу, без сравнения строк и выделения
+ * памяти.
+ */
+
+/**
+ * Идентификатор события. Идентификаторы плотные: 0, 1, 2, ... в порядке
+ * регистрации имён, поэтому ими можно индексировать массивы.
+ */
+typedef std::uint32_t EventId;
+
+/**
+ * Таблица имён событий. Intern вызывается при инициализации, а не при
+ * каждом уведомлении; имя по идентификатору нужно только для журналов.
+ */
+class EventNames {
+ private:
+  std::unordered_map<std::string, EventId> ids_;
+  std::vector<std::string> names_;
+
+ public:
+  static EventNames &Instance() {
+    static EventNames instance;
+    return instance;
+  }
+  EventId Intern(const std::string &name) {
+    std::unordered_map<std::string, EventId>::const_iterator it = ids_.find(name);
+    if (it != ids_.end()) {
+      return it->second;
+    }
+    EventId id = static_cast<EventId>(names_.size());
+    ids_[name] = id;
+    names_.push_back(name);
+    return id;
+  }
+  const std::string &Name(EventId id) const {
+    return names_[id];
+  }
+  std::size_t size() const {
+    return names_.size();
+  }
+};
+
+static const EventId kEventA = EventNames::Instance().Intern("A");
+static const EventId kEventB = EventNames::Instance().Intern("B");
+static const EventId kEventC = EventNames::Instance().Intern("C");
+static const EventId kEventD = EventNames::Instance().Intern("D");
+
+/**
+ * Вид компонента-отправителя. Как и события, виды плотные.
+ */
+enum ComponentKind {
+  COMPONENT_1 = 0,
+  COMPONENT_2,
+  COMPONENT_KIND_COUNT
+};
+
+class BaseComponent;
+class Mediator {
+ public:
+  virtual ~Mediator() {
+  }
+  virtual void Notify(BaseComponent *sender, EventId event) const = 0;
+};
+
+class BaseComponent {
+ protected:
+  Mediator *mediator_;
+  ComponentKind kind_;
+  bool verbose_;
+
+ public:
+  BaseComponent(ComponentKind kind, Mediator *mediator = nullptr)
+      : mediator_(mediator), kind_(kind), verbose_(true) {
+  }
+  void set_mediator(Mediator *mediator) {
+    this->mediator_ = mediator;
+  }
+  void set_verbose(bool verbose) {
+    this->verbose_ = verbose;
+  }
+  ComponentKind kind() const {
+    return kind_;
+  }
+};
+
+class Component1 : public BaseComponent {
+ public:
+  std::uint64_t operations = 0;
+
+  Component1() : BaseComponent(COMPONENT_1) {
+  }
+  void DoA() {
+    operations++;
+    if (verbose_) {
+      std::cout << "Component 1 does A.\n";
+    }
+    this->mediator_->Notify(this, kEventA);
+  }
+  void DoB() {
+    operations++;
+    if (verbose_) {
+      std::cout << "Component 1 does B.\n";
+    }
+    this->mediator_->Notify(this, kEventB);
+  }
+};
+
+class Component2 : public BaseComponent {
+ public:
+  std::uint64_t operations = 0;
+
+  Component2() : BaseComponent(COMPONENT_2) {
+  }
+  void DoC() {
+    operations++;
+    if (verbose_) {
+      std::cout << "Component 2 does C.\n";
+    }
+    this->mediator_->Notify(this, kEventC);
+  }
+  void DoD() {
+    operations++;
+    if (verbose_) {
+      std::cout << "Component 2 does D.\n";
+    }
+    this->mediator_->Notify(this, kEventD);
+  }
+};
+
+/**
+ * Посредник с таблицей диспетчеризации. Обработчик — обычная функция и
+ * указатель на контекст, чтобы вызов не требовал std::function и выделения
+ * памяти. Обработчики одного слота вызываются в порядке регистрации.
+ */
+class DispatchMediator : public Mediator {
+ public:
+  typedef void (*HandlerFunction)(void *context, BaseComponent *sender);
+
+ private:
+  struct Handler {
+    HandlerFunction function;
+    void *context;
+  };
+
+  std::size_t event_count_;
+  std::vector<std::vector<Handler> > slots_;
+
+  std::size_t Slot(ComponentKind kind, EventId event) const {
+    return static_cast<std::size_t>(kind) * event_count_ + event;
+  }
+
+ public:
+  /**
+   * Размер таблицы фиксируется при создании: события, зарегистрированные
+   * позже, посредник не знает.
+   */
+  DispatchMediator()
+      : event_count_(EventNames::Instance().size()), slots_(COMPONENT_KIND_COUNT * event_count_) {
+  }
+
+  void On(ComponentKind kind, EventId event, HandlerFunction function, void *context) {
+    if (event >= event_count_) {
+      throw std::out_of_range("DispatchMediator: event " + std::to_string(event) + " is unknown");
+    }
+    Handler handler = {function, context};
+    slots_[Slot(kind, event)].push_back(handler);
+  }
+
+  /**
+   * Событие, зарегистрированное после создания посредника, не имеет
+   * обработчиков и, как в основном примере, просто игнорируется.
+   */
+  void Notify(BaseComponent *sender, EventId event) const override {
+    if (event >= event_count_) {
+      return;
+    }
+    const std::vector<Handler> &handlers = slots_[Slot(sender->kind(), event)];
+    for (std::size_t i = 0; i < handlers.size(); i++) {
+      handlers[i].function(handlers[i].context, sender);
+    }
+  }
+};
+
+class ConcreteMediator : public DispatchMediator {
+ private:
+  Component1 *component1_;
+  Component2 *component2_;
+  bool verbose_;
+
+  static void OnA(void *context, BaseComponent *) {
+    ConcreteMediator *self = static_cast<ConcreteMediator *>(context);
+    if (self->verbose_) {
+      std::cout << "Mediator reacts on A and triggers following operations:\n";
+    }
+    self->component2_->DoC();
+  }
+  static void OnD(void *context, BaseComponent *) {
+    ConcreteMediator *self = static_cast<ConcreteMediator *>(context);
+    if (self->verbose_) {
+      std::cout << "Mediator reacts on D and triggers following operations:\n";
+    }
+    self->component1_->DoB();
+    self->component2_->DoC();
+  }
+
+ public:
+  ConcreteMediator(Component1 *c1, Component2 *c2, bool verbose = true)
+      : component1_(c1), component2_(c2), verbose_(verbose) {
+    this->component1_->set_mediator(this);
+    this->component2_->set_mediator(this);
+    this->component1_->set_verbose(verbose);
+    this->component2_->set_verbose(verbose);
+    On(COMPONENT_1, kEventA, &ConcreteMediator::OnA, this);
+    On(COMPONENT_2, kEventD, &ConcreteMediator::OnD, this);
+  }
+};
+
+/**
+ * Посредник в прежнем виде, для сравнения: событие превращается обратно в
+ * строку, передаётся по значению и сравнивается с каждым известным именем.
+ * Реакции те же, что у ConcreteMediator, и вызывают те же операции
+ * компонентов.
+ */
+class StringMediator : public Mediator {
+ private:
+  Component1 *component1_;
+  Component2 *component2_;
+
+  void NotifyByName(BaseComponent *, std::string event) const {
+    if (event == "A") {
+      this->component2_->DoC();
+    }
+    if (event == "D") {
+      this->component1_->DoB();
+      this->component2_->DoC();
+    }
+  }
+
+ public:
+  StringMediator(Component1 *c1, Component2 *c2) : component1_(c1), component2_(c2) {
+    this->component1_->set_mediator(this);
+    this->component2_->set_mediator(this);
+    this->component1_->set_verbose(false);
+    this->component2_->set_verbose(false);
+  }
+  void Notify(BaseComponent *sender, EventId event) const override {
+    NotifyByName(sender, EventNames::Instance().Name(event));
+  }
+};
+
+/**
+ * Клиентский код.
+ */
+
+void ClientCode() {
+  Component1 *c1 = new Component1;
+  Component2 *c2 = new Component2;
+  ConcreteMediator *mediator = new ConcreteMediator(c1, c2);
+  std::cout << "Client triggers operation A.\n";
+  c1->DoA();
+  std::cout << "\n";
+  std::cout << "Client triggers operation D.\n";
+  c2->DoD();
+  std::cout << "\n";
+
+  delete c1;
+  delete c2;
+  delete mediator;
+}
+
+/**
+ * Клиент поочерёдно вызывает DoA и DoD; каждая пара даёт 5 уведомлений.
+ */
+void Benchmark(std::size_t pairs) {
+  typedef std::chrono::steady_clock Clock;
+  const std::size_t kNotificationsPerPair = 5;
+
+  Component1 c1;
+  Component2 c2;
+  ConcreteMediator mediator(&c1, &c2, false);
+  Clock::time_point start = Clock::now();
+  for (std::size_t i = 0; i < pairs; i++) {
+    c1.DoA();
+    c2.DoD();
+  }
+  double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  std::cout << "Benchmark: " << pairs * kNotificationsPerPair << " notifications\n";
+  std::cout << "dispatch table:  " << pairs * kNotificationsPerPair / seconds / 1e6 << " M notifications/s ("
+            << c1.operations + c2.operations << " operations)\n";
+
+  Component1 s1;
+  Component2 s2;
+  StringMediator strings(&s1, &s2);
+  start = Clock::now();
+  for (std::size_t i = 0; i < pairs; i++) {
+    s1.DoA();
+    s2.DoD();
+  }
+  seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  std::cout << "string compares: " << pairs * kNotificationsPerPair / seconds / 1e6 << " M notifications/s ("
+            << s1.operations + s2.operations << " operations)\n";
+}
+
+int main(int argc, char *argv[]) {
+  ClientCode();
+  std::size_t pairs = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000000;
+  Benchmark(pairs);
+  return 0;
+}
@@ -0,0 +1,544 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+/**
+ * Паттерн Посредник
+ *
+ * Назначение: Позволяет уменьшить связанность множества классов между собой,
+ * благодаря перемещению этих связей в один класс-посредник.
+ *
+ * В основном примере Notify сразу вызывает методы других компонентов, а те
+ * снова вызывают Notify. Каскад событий превращается в рекурсию, глубина
+ * которой ничем не ограничена, и всё выполняется в потоке того, кто вызвал
+ * первый метод. Здесь Notify только кладёт событие в ограниченную очередь, а
+ * реакции выполняет цикл обработки или пул рабочих потоков. Каскад становится
+ * итерацией: глубина стека не зависит от длины каскада. Для каждого
+ * исходного события посредник считает, сколько событий оно вызвало.
+ */
+
+class BaseComponent;
+class Mediator {
+ public:
+  virtual ~Mediator() {
+  }
+  virtual void Notify(BaseComponent *sender, std::string event) = 0;
+};
+
+class BaseComponent {
+ protected:
+  Mediator *mediator_;
+  bool verbose_;
+
+ public:
+  std::atomic<std::uint64_t> operations;
+
+  BaseComponent(Mediator *mediator = nullptr) : mediator_(mediator), verbose_(true), operations(0) {
+  }
+  void set_mediator(Mediator *mediator) {
+    this->mediator_ = mediator;
+  }
+  void set_verbose(bool verbose) {
+    this->verbose_ = verbose;
+  }
+};
+
+class Component1 : public BaseComponent {
+ public:
+  void DoA() {
+    operations++;
+    if (verbose_) {
+      std::cout << "Component 1 does A.\n";
+    }
+    this->mediator_->Notify(this, "A");
+  }
+  void DoB() {
+    operations++;
+    if (verbose_) {
+      std::cout << "Component 1 does B.\n";
+    }
+    this->mediator_->Notify(this, "B");
+  }
+};
+
+class Component2 : public BaseComponent {
+ public:
+  void DoC() {
+    operations++;
+    if (verbose_) {
+      std::cout << "Component 2 does C.\n";
+    }
+    this->mediator_->Notify(this, "C");
+  }
+  void DoD() {
+    operations++;
+    if (verbose_) {
+      std::cout << "Component 2 does D.\n";
+    }
+    this->mediator_->Notify(this, "D");
+  }
+};
+
+/**
+ * Правила взаимодействия компонентов те же, что в основном примере. Способ
+ * доставки событий (рекурсивный или через очередь) определяют подклассы.
+ *
+ * Обратная связь «C -> D» выключена по умолчанию. Она нужна, чтобы получить
+ * длинный каскад: каждое событие C снова вызывает D, пока не кончится
+ * заданный бюджет.
+ */
+class ConcreteMediator : public Mediator {
+ protected:
+  Component1 *component1_;
+  Component2 *component2_;
+  bool verbose_;
+  std::atomic<long> feedback_;
+
+  void React(BaseComponent *, const std::string &event) {
+    if (event == "A") {
+      if (verbose_) {
+        std::cout << "Mediator reacts on A and triggers following operations:\n";
+      }
+      this->component2_->DoC();
+    }
+    if (event == "C") {
+      if (feedback_.load(std::memory_order_relaxed) > 0 && feedback_.fetch_sub(1, std::memory_order_relaxed) > 0) {
+        this->component2_->DoD();
+      }
+    }
+    if (event == "D") {
+      if (verbose_) {
+        std::cout << "Mediator reacts on D and triggers following operations:\n";
+      }
+      this->component1_->DoB();
+      this->component2_->DoC();
+    }
+  }
+
+ public:
+  ConcreteMediator(Component1 *c1, Component2 *c2, bool verbose)
+      : component1_(c1), component2_(c2), verbose_(verbose), feedback_(0) {
+    this->component1_->set_mediator(this);
+    this->component2_->set_mediator(this);
+    this->component1_->set_verbose(verbose);
+    this->component2_->set_verbose(verbose);
+  }
+  void set_feedback(long budget) {
+    feedback_ = budget;
+  }
+};
+
+/**
+ * Посредник в прежнем виде: реакция выполняется прямо внутри Notify.
+ * Считает наибольшую глубину вложенных вызовов Notify.
+ */
+class RecursiveMediator : public ConcreteMediator {
+ private:
+  std::size_t depth_;
+  std::size_t max_depth_;
+
+ public:
+  RecursiveMediator(Component1 *c1, Component2 *c2, bool verbose = true)
+      : ConcreteMediator(c1, c2, verbose), depth_(0), max_depth_(0) {
+  }
+  void Notify(BaseComponent *sender, std::string event) override {
+    depth_++;
+    max_depth_ = std::max(max_depth_, depth_);
+    React(sender, event);
+    depth_--;
+  }
+  std::size_t max_depth() const {
+    return max_depth_;
+  }
+};
+
+/**
+ * Статистика каскадов одного исходного события. Исходное событие — то, что
+ * пришло извне, а не из реакции посредника. Размер каскада — число его
+ * обработанных событий, включая исходное. Разветвление — число событий,
+ * которые вызвала одна реакция; глубина — длина самой длинной цепочки
+ * «событие -> реакция -> событие».
+ */
+struct CascadeStats {
+  std::size_t cascades = 0;
+  std::size_t events = 0;
+  std::size_t max_size = 0;
+  std::size_t max_fan_out = 0;
+  std::size_t max_depth = 0;
+  std::size_t dropped = 0;
+};
+
+/**
+ * Посредник с очередью событий. Notify кладёт событие в очередь и сразу
+ * возвращает управление; реакции выполняет Drain (в потоке вызывающего) или
+ * пул потоков, запущенный Start.
+ *
+ * Длина очереди ограничена capacity. Внешние события допускаются, только
+ * пока в очереди меньше admission_limit событий: при работающем пуле
+ * отправитель ждёт, без пула событие отбрасывается. Остаток очереди
+ * оставлен для событий из реакций — их нельзя заставить ждать, ведь ждать
+ * пришлось бы тому самому потоку, который разбирает очередь. Если очередь
+ * всё же заполнена, событие из реакции отбрасывается и учитывается в
+ * статистике его каскада.
+ */
+class QueuedMediator : public ConcreteMediator {
+ private:
+  /**
+   * Общее состояние одного каскада. pending — число событий каскада, которые
+   * ещё в очереди или обрабатываются; когда оно становится нулём, каскад
+   * завершён и его итоги попадают в статистику.
+   */
+  struct Cascade {
+    std::string root;
+    std::atomic<std::size_t> pending;
+    std::atomic<std::size_t> events;
+    std::atomic<std::size_t> max_fan_out;
+    std::atomic<std::size_t> max_depth;
+    std::atomic<std::size_t> dropped;
+
+    explicit Cascade(const std::string &root_event)
+        : root(root_event), pending(1), events(0), max_fan_out(0), max_depth(0), dropped(0) {
+    }
+  };
+
+  /**
+   * children — сколько событий вызвала реакция на это событие. Его меняет
+   * только Notify в потоке, который выполняет реакцию, поэтому счётчик не
+   * атомарный.
+   */
+  struct Envelope {
+    BaseComponent *sender;
+    std::string event;
+    Cascade *cascade;
+    std::size_t depth;
+    mutable std::size_t children;
+  };
+
+  static void UpdateMax(std::atomic<std::size_t> *max, std::size_t value) {
+    std::size_t current = max->load(std::memory_order_relaxed);
+    while (current < value && !max->compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+  }
+
+  /**
+   * Событие, реакция на которое сейчас выполняется в этом потоке. По нему
+   * Notify узнаёт, что событие пришло из реакции и к какому каскаду оно
+   * относится.
+   */
+  static thread_local const Envelope *current_;
+
+  const std::size_t capacity_;
+  const std::size_t admission_limit_;
+  std::deque<Envelope> queue_;
+  std::size_t high_water_;
+  std::size_t in_flight_;
+  bool stopping_;
+  mutable std::mutex mutex_;
+  std::condition_variable not_empty_;
+  std::condition_variable not_full_;
+  std::condition_variable idle_;
+  std::vector<std::thread> workers_;
+
+  std::mutex stats_mutex_;
+  std::map<std::string, CascadeStats> stats_;
+
+  void Finish(Cascade *cascade) {
+    if (cascade->pending.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+      return;
+    }
+    std::size_t events = cascade->events.load(std::memory_order_relaxed);
+    {
+      std::lock_guard<std::mutex> lock(stats_mutex_);
+      CascadeStats &stats = stats_[cascade->root];
+      stats.cascades++;
+      stats.events += events;
+      stats.max_size = std::max(stats.max_size, events);
+      stats.max_fan_out = std::max(stats.max_fan_out, cascade->max_fan_out.load(std::memory_order_relaxed));
+      stats.max_depth = std::max(stats.max_depth, cascade->max_depth.load(std::memory_order_relaxed));
+      stats.dropped += cascade->dropped.load(std::memory_order_relaxed);
+    }
+    delete cascade;
+  }
+
+  void Dispatch(const Envelope &envelope) {
+    Cascade *cascade = envelope.cascade;
+    cascade->events.fetch_add(1, std::memory_order_relaxed);
+    UpdateMax(&cascade->max_depth, envelope.depth);
+    envelope.children = 0;
+    current_ = &envelope;
+    React(envelope.sender, envelope.event);
+    current_ = nullptr;
+    UpdateMax(&cascade->max_fan_out, envelope.children);
+    Finish(cascade);
+  }
+
+  /**
+   * Забирает событие из очереди. Если wait, ждёт, пока событие появится или
+   * пул остановят.
+   */
+  bool Pop(Envelope *envelope, bool wait) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (wait) {
+      not_empty_.wait(lock, [this] { return !queue_.empty() || stopping_; });
+    }
+    if (queue_.empty()) {
+      return false;
+    }
+    *envelope = std::move(queue_.front());
+    queue_.pop_front();
+    in_flight_++;
+    not_full_.notify_one();
+    return true;
+  }
+
+  void Done() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    in_flight_--;
+    if (in_flight_ == 0 && queue_.empty()) {
+      idle_.notify_all();
+    }
+  }
+
+  void WorkerLoop() {
+    Envelope envelope;
+    while (Pop(&envelope, true)) {
+      Dispatch(envelope);
+      Done();
+    }
+  }
+
+ public:
+  QueuedMediator(Component1 *c1, Component2 *c2, std::size_t capacity, bool verbose = true)
+      : ConcreteMediator(c1, c2, verbose), capacity_(capacity), admission_limit_(capacity / 2), high_water_(0),
+        in_flight_(0), stopping_(false) {
+  }
+  ~QueuedMediator() {
+    Stop();
+  }
+
+  void Notify(BaseComponent *sender, std::string event) override {
+    const Envelope *parent = current_;
+    Envelope envelope;
+    envelope.sender = sender;
+    envelope.event = std::move(event);
+    envelope.children = 0;
+    if (parent != nullptr) {
+      parent->children++;
+      envelope.cascade = parent->cascade;
+      envelope.depth = parent->depth + 1;
+      envelope.cascade->pending.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      envelope.cascade = new Cascade(envelope.event);
+      envelope.depth = 0;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    std::size_t limit = parent != nullptr ? capacity_ : admission_limit_;
+    if (parent == nullptr && !workers_.empty()) {
+      not_full_.wait(lock, [this] { return queue_.size() < admission_limit_ || stopping_; });
+    }
+    if (queue_.size() >= limit || stopping_) {
+      lock.unlock();
+      envelope.cascade->dropped.fetch_add(1, std::memory_order_relaxed);
+      Finish(envelope.cascade);
+      return;
+    }
+    queue_.push_back(std::move(envelope));
+    high_water_ = std::max(high_water_, queue_.size());
+    not_empty_.notify_one();
+  }
+
+  /**
+   * Цикл обработки в потоке вызывающего: разбирает очередь, пока она не
+   * опустеет, включая события, появившиеся по ходу. Возвращает число
+   * обработанных событий.
+   */
+  std::size_t Drain() {
+    std::size_t processed = 0;
+    Envelope envelope;
+    while (Pop(&envelope, false)) {
+      Dispatch(envelope);
+      Done();
+      processed++;
+    }
+    return processed;
+  }
+
+  void Start(unsigned threads) {
+    for (unsigned i = 0; i < threads; i++) {
+      workers_.push_back(std::thread(&QueuedMediator::WorkerLoop, this));
+    }
+  }
+
+  /**
+   * Ждёт, пока очередь опустеет и все начатые реакции закончатся.
+   */
+  void Wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_.wait(lock, [this] { return queue_.empty() && in_flight_ == 0; });
+  }
+
+  /**
+   * С пулом ждёт, пока очередь опустеет, и останавливает рабочие потоки.
+   * Без пула разбирать очередь некому, поэтому оставшиеся события
+   * отбрасываются и учитываются в статистике своих каскадов.
+   */
+  void Stop() {
+    if (workers_.empty()) {
+      Discard();
+      return;
+    }
+    Wait();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    not_empty_.notify_all();
+    not_full_.notify_all();
+    for (std::size_t i = 0; i < workers_.size(); i++) {
+      workers_[i].join();
+    }
+    workers_.clear();
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = false;
+  }
+
+  std::size_t Discard() {
+    std::deque<Envelope> discarded;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      discarded.swap(queue_);
+    }
+    not_full_.notify_all();
+    for (std::size_t i = 0; i < discarded.size(); i++) {
+      discarded[i].cascade->dropped.fetch_add(1, std::memory_order_relaxed);
+      Finish(discarded[i].cascade);
+    }
+    return discarded.size();
+  }
+
+  std::size_t high_water() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return high_water_;
+  }
+
+  void PrintStats() {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    std::cout << "event\tcascades\tevents\tmax size\tmax fan-out\tmax depth\tdropped\n";
+    for (std::map<std::string, CascadeStats>::const_iterator it = stats_.begin(); it != stats_.end(); ++it) {
+      const CascadeStats &stats = it->second;
+      std::cout << it->first << "\t" << stats.cascades << "\t\t" << stats.events << "\t" << stats.max_size << "\t\t" << stats.max_fan_out << "\t\t"
+                << stats.max_depth << "\t\t" << stats.dropped << "\n";
+    }
+    std::cout << "queue high water: " << high_water() << " of " << capacity_ << "\n";
+  }
+};
+
+thread_local const QueuedMediator::Envelope *QueuedMediator::current_ = nullptr;
+
+/**
+ * Клиентский код.
+ */
+
+void ClientCode() {
+  Component1 *c1 = new Component1;
+  Component2 *c2 = new Component2;
+  QueuedMediator *mediator = new QueuedMediator(c1, c2, 16);
+  std::cout << "Client triggers operation A.\n";
+  c1->DoA();
+  mediator->Drain();
+  std::cout << "\n";
+  std::cout << "Client triggers operation D.\n";
+  c2->DoD();
+  mediator->Drain();
+  std::cout << "\n";
+  mediator->PrintStats();
+  std::cout << "\n";
+
+  delete mediator;
+  delete c1;
+  delete c2;
+}
+
+/**
+ * Длинный каскад: с обратной связью «C -> D» одно событие D вызывает
+ * 3 * budget событий. Рекурсивный посредник уходит в глубину стека на
+ * каждое звено, очередь же никогда не растёт больше чем на пару событий.
+ */
+void LongCascade(long budget) {
+  Component1 c1;
+  Component2 c2;
+  std::cout << "Long cascade, feedback budget " << budget << "\n";
+  {
+    long recursive_budget = std::min(budget, 10000L);
+    RecursiveMediator mediator(&c1, &c2, false);
+    mediator.set_feedback(recursive_budget);
+    c2.DoD();
+    std::cout << "recursive (budget " << recursive_budget << "): max nested Notify depth " << mediator.max_depth()
+              << "\n";
+  }
+  QueuedMediator mediator(&c1, &c2, 64, false);
+  mediator.set_feedback(budget);
+  c2.DoD();
+  std::size_t processed = mediator.Drain();
+  std::cout << "queued: processed " << processed << " events with Notify depth 1\n";
+  mediator.PrintStats();
+  std::cout << "\n";
+}
+
+/**
+ * Пул потоков: producers потоков отправляют события A и D, workers потоков
+ * выполняют реакции.
+ */
+void Benchmark(unsigned producers, unsigned workers, std::size_t events_per_producer) {
+  typedef std::chrono::steady_clock Clock;
+  Component1 c1;
+  Component2 c2;
+  QueuedMediator mediator(&c1, &c2, 1024, false);
+  mediator.Start(workers);
+
+  Clock::time_point start = Clock::now();
+  std::vector<std::thread> threads;
+  for (unsigned p = 0; p < producers; p++) {
+    threads.push_back(std::thread([&] {
+      for (std::size_t i = 0; i < events_per_producer; i++) {
+        if (i % 2 == 0) {
+          c1.DoA();
+        } else {
+          c2.DoD();
+        }
+      }
+    }));
+  }
+  for (std::size_t i = 0; i < threads.size(); i++) {
+    threads[i].join();
+  }
+  mediator.Wait();
+  double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+  std::uint64_t operations = c1.operations + c2.operations;
+  std::cout << "Worker pool: " << producers << " producers, " << workers << " workers\n";
+  std::cout << operations << " operations in " << seconds * 1e3 << " ms, " << operations / seconds / 1e6
+            << " M operations/s\n";
+  mediator.PrintStats();
+}
+
+int main(int argc, char *argv[]) {
+  ClientCode();
+  long budget = argc > 1 ? std::atol(argv[1]) : 1000000;
+  LongCascade(budget);
+  std::size_t events = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 200000;
+  Benchmark(2, 4, events);
+  return 0;
+}
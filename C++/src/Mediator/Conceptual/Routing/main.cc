@@ -0,0 +1,838 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+/**
+ * Паттерн Посредник
+ *
+ * Назначение: Позволяет уменьшить связанность множества классов между собой,
+ * благодаря перемещению этих связей в один класс-посредник.
+ *
+ * ConcreteMediator из основного примера знает ровно два компонента, и его
+ * правила зашиты в код. Здесь посредник — реестр: компоненты регистрируются
+ * в нём и подписываются на темы, а посредник хранит таблицу маршрутов «тема
+ * -> подписчики». У каждого компонента свой почтовый ящик — очередь без
+ * блокировок, в которую могут писать любые потоки, а читает только один.
+ * Узлы сообщений берутся из пулов потоков, так что доставка не проходит
+ * через общий аллокатор. Компоненты распределены между рабочими потоками,
+ * так что сообщения одному компоненту обрабатываются по очереди и ему не
+ * нужна своя синхронизация.
+ */
+
+typedef std::uint32_t ComponentId;
+typedef std::uint32_t TopicId;
+
+/**
+ * Очередь Вьюкова: много писателей, один читатель, без блокировок. Узлы
+ * встроены в сами элементы, поэтому Push не выделяет память. Pop может
+ * вернуть nullptr, пока писатель не закончил Push, даже если очередь не
+ * пуста; читатель в этом случае просто заглянет позже.
+ */
+struct MpscNode {
+  std::atomic<MpscNode *> next;
+};
+
+class MpscQueue {
+ private:
+  std::atomic<MpscNode *> head_;
+  char padding_[64];
+  MpscNode *tail_;
+  MpscNode stub_;
+
+ public:
+  MpscQueue() : head_(&stub_), tail_(&stub_) {
+    stub_.next.store(nullptr, std::memory_order_relaxed);
+  }
+  MpscQueue(const MpscQueue &) = delete;
+  MpscQueue &operator=(const MpscQueue &) = delete;
+
+  void Push(MpscNode *node) {
+    node->next.store(nullptr, std::memory_order_relaxed);
+    MpscNode *previous = head_.exchange(node, std::memory_order_seq_cst);
+    previous->next.store(node, std::memory_order_release);
+  }
+
+  MpscNode *Pop() {
+    MpscNode *tail = tail_;
+    MpscNode *next = tail->next.load(std::memory_order_acquire);
+    if (tail == &stub_) {
+      if (next == nullptr) {
+        return nullptr;
+      }
+      tail_ = next;
+      tail = next;
+      next = next->next.load(std::memory_order_acquire);
+    }
+    if (next != nullptr) {
+      tail_ = next;
+      return tail;
+    }
+    if (tail != head_.load(std::memory_order_acquire)) {
+      return nullptr;
+    }
+    Push(&stub_);
+    next = tail->next.load(std::memory_order_acquire);
+    if (next != nullptr) {
+      tail_ = next;
+      return tail;
+    }
+    return nullptr;
+  }
+
+  /**
+   * Вызывается только читателем. Очередь считается непустой и тогда, когда
+   * писатель уже начал Push, но ещё не закончил.
+   */
+  bool Empty() const {
+    return tail_ == &stub_ && head_.load(std::memory_order_seq_cst) == &stub_;
+  }
+};
+
+class MessagePool;
+
+struct Message : MpscNode {
+  MessagePool *pool;
+  ComponentId sender;
+  TopicId topic;
+  std::uint64_t payload;
+};
+
+/**
+ * Пул узлов сообщений одного потока. Поток берёт узлы только из своего
+ * пула, без синхронизации. Вернуть узел может любой поток: чужой узел
+ * попадает в очередь returned_ пула-владельца, и владелец забирает такие
+ * узлы, когда его свободный список пустеет. Память выделяется блоками по
+ * kBlockSize узлов и освобождается только вместе с пулом, поэтому в
+ * установившемся режиме доставка сообщения не обращается к аллокатору.
+ */
+class MessagePool {
+ private:
+  static const std::size_t kBlockSize = 256;
+
+  Message *free_;
+  MpscQueue returned_;
+  std::vector<std::unique_ptr<Message[]> > blocks_;
+
+  void PushFree(Message *message) {
+    message->next.store(free_, std::memory_order_relaxed);
+    free_ = message;
+  }
+
+ public:
+  MessagePool() : free_(nullptr) {
+  }
+  MessagePool(const MessagePool &) = delete;
+  MessagePool &operator=(const MessagePool &) = delete;
+
+  /**
+   * Вызывается только потоком-владельцем.
+   */
+  Message *Allocate() {
+    if (free_ == nullptr) {
+      while (MpscNode *node = returned_.Pop()) {
+        PushFree(static_cast<Message *>(node));
+      }
+    }
+    if (free_ == nullptr) {
+      blocks_.push_back(std::unique_ptr<Message[]>(new Message[kBlockSize]));
+      for (std::size_t i = 0; i < kBlockSize; i++) {
+        blocks_.back()[i].pool = this;
+        PushFree(&blocks_.back()[i]);
+      }
+    }
+    Message *message = free_;
+    free_ = static_cast<Message *>(message->next.load(std::memory_order_relaxed));
+    return message;
+  }
+
+  /**
+   * owner — пул потока, который возвращает узел.
+   */
+  static void Release(Message *message, MessagePool *owner) {
+    if (message->pool == owner) {
+      owner->PushFree(message);
+    } else {
+      message->pool->returned_.Push(message);
+    }
+  }
+};
+
+class BaseComponent;
+class Mediator {
+ public:
+  virtual ~Mediator() {
+  }
+  /**
+   * Доставляет сообщение всем подписчикам темы.
+   */
+  virtual void Publish(const BaseComponent *sender, TopicId topic, std::uint64_t payload) = 0;
+  /**
+   * Доставляет сообщение одному компоненту, минуя таблицу маршрутов.
+   */
+  virtual void Send(const BaseComponent *sender, ComponentId target, TopicId topic, std::uint64_t payload) = 0;
+};
+
+class BaseComponent {
+ protected:
+  Mediator *mediator_;
+  ComponentId id_;
+
+ public:
+  BaseComponent() : mediator_(nullptr), id_(0) {
+  }
+  virtual ~BaseComponent() {
+  }
+  void set_mediator(Mediator *mediator, ComponentId id) {
+    this->mediator_ = mediator;
+    this->id_ = id;
+  }
+  ComponentId id() const {
+    return id_;
+  }
+  virtual void Receive(const Message &message) = 0;
+};
+
+/**
+ * Счётчик, разнесённый по строкам кэша: каждый поток увеличивает свою
+ * ячейку, а сумму считают только при ожидании.
+ */
+class ShardedCounter {
+ private:
+  static const std::size_t kShards = 64;
+  struct Shard {
+    std::atomic<std::uint64_t> value;
+    char padding[64 - sizeof(std::atomic<std::uint64_t>)];
+  };
+  Shard shards_[kShards];
+
+  static std::size_t ThreadShard() {
+    static std::atomic<std::size_t> next(0);
+    static thread_local std::size_t shard = next.fetch_add(1) % kShards;
+    return shard;
+  }
+
+ public:
+  ShardedCounter() {
+    for (std::size_t i = 0; i < kShards; i++) {
+      shards_[i].value.store(0, std::memory_order_relaxed);
+    }
+  }
+  /**
+   * release и acquire в Sum гарантируют: кто увидел увеличение, тот видит и
+   * всё, что поток сделал до него, в том числе его увеличения других
+   * счётчиков.
+   */
+  void Add(std::uint64_t n) {
+    shards_[ThreadShard()].value.fetch_add(n, std::memory_order_release);
+  }
+  std::uint64_t Sum() const {
+    std::uint64_t sum = 0;
+    for (std::size_t i = 0; i < kShards; i++) {
+      sum += shards_[i].value.load(std::memory_order_acquire);
+    }
+    return sum;
+  }
+};
+
+/**
+ * Посредник-маршрутизатор. Регистрация компонентов, создание тем и подписки
+ * выполняются до Start: во время работы таблица маршрутов только читается,
+ * и ей не нужна синхронизация.
+ *
+ * Почтовый ящик компонента попадает в очередь готовых ящиков своего рабочего
+ * потока, когда в нём появляется первое сообщение; флаг scheduled не даёт
+ * поставить ящик в очередь дважды. Рабочий поток за раз разбирает не больше
+ * kBatch сообщений одного ящика, чтобы занятый компонент не задерживал
+ * остальных.
+ */
+class RoutingMediator : public Mediator {
+ private:
+  static const std::size_t kBatch = 64;
+
+  struct Mailbox : MpscNode {
+    MpscQueue messages;
+    std::atomic<bool> scheduled;
+    BaseComponent *component;
+    unsigned worker;
+  };
+
+  struct Worker {
+    MpscQueue ready;
+    std::atomic<bool> sleeping;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::thread thread;
+  };
+
+  std::vector<std::unique_ptr<Mailbox> > mailboxes_;
+  std::vector<std::unique_ptr<Worker> > workers_;
+  std::unordered_map<std::string, TopicId> topic_ids_;
+  std::vector<std::vector<ComponentId> > routes_;
+  std::atomic<bool> running_;
+  ShardedCounter sent_;
+  ShardedCounter handled_;
+
+  /**
+   * Пулы сообщений принадлежат посреднику, а не потокам: поток может
+   * завершиться, пока его узлы ещё лежат в чужих почтовых ящиках. Поток
+   * находит свой пул через thread_local кэш, ключ которого — номер
+   * экземпляра посредника, а не его адрес, который может достаться новому
+   * посреднику.
+   */
+  static std::atomic<std::uint64_t> next_instance_;
+  const std::uint64_t instance_;
+  std::mutex pools_mutex_;
+  std::unordered_map<std::thread::id, std::unique_ptr<MessagePool> > pools_;
+
+  MessagePool *ThreadPool() {
+    struct Cache {
+      std::uint64_t instance;
+      MessagePool *pool;
+    };
+    static thread_local Cache cache = {0, nullptr};
+    if (cache.instance != instance_) {
+      std::lock_guard<std::mutex> lock(pools_mutex_);
+      std::unique_ptr<MessagePool> &pool = pools_[std::this_thread::get_id()];
+      if (!pool) {
+        pool.reset(new MessagePool);
+      }
+      cache.instance = instance_;
+      cache.pool = pool.get();
+    }
+    return cache.pool;
+  }
+
+  void CheckNotRunning(const char *operation) const {
+    if (running_.load()) {
+      throw std::logic_error(std::string("RoutingMediator: ") + operation + " while running");
+    }
+  }
+
+  void Schedule(Mailbox *mailbox) {
+    Worker &worker = *workers_[mailbox->worker];
+    worker.ready.Push(mailbox);
+    if (worker.sleeping.load()) {
+      worker.wake.notify_one();
+    }
+  }
+
+  void Deliver(const BaseComponent *sender, ComponentId target, TopicId topic, std::uint64_t payload) {
+    Mailbox *mailbox = mailboxes_[target].get();
+    Message *message = ThreadPool()->Allocate();
+    message->sender = sender != nullptr ? sender->id() : target;
+    message->topic = topic;
+    message->payload = payload;
+    sent_.Add(1);
+    mailbox->messages.Push(message);
+    if (!mailbox->scheduled.exchange(true)) {
+      Schedule(mailbox);
+    }
+  }
+
+  void Process(Mailbox *mailbox) {
+    MessagePool *pool = ThreadPool();
+    std::size_t processed = 0;
+    while (processed < kBatch) {
+      MpscNode *node = mailbox->messages.Pop();
+      if (node == nullptr) {
+        break;
+      }
+      Message *message = static_cast<Message *>(node);
+      mailbox->component->Receive(*message);
+      MessagePool::Release(message, pool);
+      processed++;
+    }
+    handled_.Add(processed);
+    mailbox->scheduled.store(false);
+    if (!mailbox->messages.Empty() && !mailbox->scheduled.exchange(true)) {
+      Schedule(mailbox);
+    }
+  }
+
+  void WorkerLoop(Worker *worker) {
+    unsigned idle = 0;
+    while (running_.load(std::memory_order_relaxed)) {
+      MpscNode *node = worker->ready.Pop();
+      if (node != nullptr) {
+        Process(static_cast<Mailbox *>(node));
+        idle = 0;
+        continue;
+      }
+      if (++idle < 64) {
+        std::this_thread::yield();
+        continue;
+      }
+      /**
+       * Уведомление от писателя может проскочить между проверкой очереди и
+       * засыпанием, поэтому сон ограничен по времени.
+       */
+      std::unique_lock<std::mutex> lock(worker->mutex);
+      worker->sleeping.store(true);
+      if (worker->ready.Empty() && running_.load()) {
+        worker->wake.wait_for(lock, std::chrono::milliseconds(1));
+      }
+      worker->sleeping.store(false);
+    }
+  }
+
+ public:
+  explicit RoutingMediator(unsigned workers) : running_(false), instance_(++next_instance_) {
+    for (unsigned i = 0; i < (workers == 0 ? 1 : workers); i++) {
+      workers_.push_back(std::unique_ptr<Worker>(new Worker));
+      workers_.back()->sleeping.store(false);
+    }
+  }
+  /**
+   * Недоставленные сообщения освобождаются вместе с пулами.
+   */
+  ~RoutingMediator() {
+    Stop();
+  }
+
+  ComponentId Register(BaseComponent *component) {
+    CheckNotRunning("Register");
+    ComponentId id = static_cast<ComponentId>(mailboxes_.size());
+    std::unique_ptr<Mailbox> mailbox(new Mailbox);
+    mailbox->scheduled.store(false);
+    mailbox->component = component;
+    mailbox->worker = id % workers_.size();
+    mailboxes_.push_back(std::move(mailbox));
+    component->set_mediator(this, id);
+    return id;
+  }
+
+  TopicId AddTopic(const std::string &name) {
+    CheckNotRunning("AddTopic");
+    std::unordered_map<std::string, TopicId>::const_iterator it = topic_ids_.find(name);
+    if (it != topic_ids_.end()) {
+      return it->second;
+    }
+    TopicId id = static_cast<TopicId>(routes_.size());
+    topic_ids_[name] = id;
+    routes_.push_back(std::vector<ComponentId>());
+    return id;
+  }
+
+  void Subscribe(ComponentId component, TopicId topic) {
+    CheckNotRunning("Subscribe");
+    if (component >= mailboxes_.size() || topic >= routes_.size()) {
+      throw std::out_of_range("RoutingMediator: unknown component or topic");
+    }
+    routes_[topic].push_back(component);
+  }
+
+  void Publish(const BaseComponent *sender, TopicId topic, std::uint64_t payload) override {
+    if (topic >= routes_.size()) {
+      throw std::out_of_range("RoutingMediator: unknown topic " + std::to_string(topic));
+    }
+    const std::vector<ComponentId> &subscribers = routes_[topic];
+    for (std::size_t i = 0; i < subscribers.size(); i++) {
+      Deliver(sender, subscribers[i], topic, payload);
+    }
+  }
+
+  void Send(const BaseComponent *sender, ComponentId target, TopicId topic, std::uint64_t payload) override {
+    if (target >= mailboxes_.size() || topic >= routes_.size()) {
+      throw std::out_of_range("RoutingMediator: unknown component or topic");
+    }
+    Deliver(sender, target, topic, payload);
+  }
+
+  void Start() {
+    CheckNotRunning("Start");
+    running_.store(true);
+    for (std::size_t i = 0; i < workers_.size(); i++) {
+      workers_[i]->thread = std::thread(&RoutingMediator::WorkerLoop, this, workers_[i].get());
+    }
+  }
+
+  /**
+   * Ждёт, пока не останется недоставленных сообщений. Потоки, которые
+   * отправляют сообщения извне, к этому моменту должны закончить работу.
+   * handled читается раньше sent: каждое обработанное сообщение уже
+   * учтено в sent, поэтому равенство значит, что очередь пуста.
+   */
+  void Wait() {
+    for (;;) {
+      std::uint64_t handled = handled_.Sum();
+      if (handled == sent_.Sum()) {
+        return;
+      }
+      std::this_thread::yield();
+    }
+  }
+
+  void Stop() {
+    if (!running_.load()) {
+      return;
+    }
+    running_.store(false);
+    for (std::size_t i = 0; i < workers_.size(); i++) {
+      workers_[i]->wake.notify_one();
+      workers_[i]->thread.join();
+    }
+  }
+
+  /**
+   * Разбирает все почтовые ящики в потоке вызывающего, пока сообщения не
+   * кончатся. Только при остановленных рабочих потоках.
+   */
+  std::uint64_t Drain() {
+    CheckNotRunning("Drain");
+    std::uint64_t before = handled_.Sum();
+    bool busy = true;
+    while (busy) {
+      busy = false;
+      for (std::size_t i = 0; i < workers_.size(); i++) {
+        while (MpscNode *node = workers_[i]->ready.Pop()) {
+          Process(static_cast<Mailbox *>(node));
+          busy = true;
+        }
+      }
+    }
+    return handled_.Sum() - before;
+  }
+
+  std::size_t components() const {
+    return mailboxes_.size();
+  }
+  std::size_t topics() const {
+    return routes_.size();
+  }
+};
+
+std::atomic<std::uint64_t> RoutingMediator::next_instance_(0);
+
+/**
+ * Посредник для сравнения: те же маршруты, но одна общая очередь под
+ * мьютексом. Он не гарантирует, что сообщения одному компоненту
+ * обрабатываются по очереди, так что компонентам нужна своя синхронизация.
+ */
+class LockedMediator : public Mediator {
+ private:
+  struct Envelope {
+    ComponentId target;
+    ComponentId sender;
+    TopicId topic;
+    std::uint64_t payload;
+  };
+
+  std::vector<BaseComponent *> components_;
+  std::vector<std::vector<ComponentId> > routes_;
+  std::deque<Envelope> queue_;
+  std::size_t in_flight_;
+  bool running_;
+  std::mutex mutex_;
+  std::condition_variable not_empty_;
+  std::condition_variable idle_;
+  std::vector<std::thread> workers_;
+
+  void Deliver(const BaseComponent *sender, ComponentId target, TopicId topic, std::uint64_t payload) {
+    Envelope envelope;
+    envelope.target = target;
+    envelope.sender = sender != nullptr ? sender->id() : target;
+    envelope.topic = topic;
+    envelope.payload = payload;
+    std::lock_guard<std::mutex> lock(mutex_);
+    queue_.push_back(envelope);
+    not_empty_.notify_one();
+  }
+
+  void WorkerLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+      not_empty_.wait(lock, [this] { return !queue_.empty() || !running_; });
+      if (queue_.empty()) {
+        return;
+      }
+      Envelope envelope = queue_.front();
+      queue_.pop_front();
+      in_flight_++;
+      lock.unlock();
+      Message message;
+      message.sender = envelope.sender;
+      message.topic = envelope.topic;
+      message.payload = envelope.payload;
+      components_[envelope.target]->Receive(message);
+      lock.lock();
+      in_flight_--;
+      if (queue_.empty() && in_flight_ == 0) {
+        idle_.notify_all();
+      }
+    }
+  }
+
+ public:
+  LockedMediator() : in_flight_(0), running_(false) {
+  }
+  ~LockedMediator() {
+    Stop();
+  }
+
+  ComponentId Register(BaseComponent *component) {
+    ComponentId id = static_cast<ComponentId>(components_.size());
+    components_.push_back(component);
+    component->set_mediator(this, id);
+    return id;
+  }
+  TopicId AddTopic() {
+    routes_.push_back(std::vector<ComponentId>());
+    return static_cast<TopicId>(routes_.size() - 1);
+  }
+  void Subscribe(ComponentId component, TopicId topic) {
+    routes_[topic].push_back(component);
+  }
+
+  void Publish(const BaseComponent *sender, TopicId topic, std::uint64_t payload) override {
+    const std::vector<ComponentId> &subscribers = routes_[topic];
+    for (std::size_t i = 0; i < subscribers.size(); i++) {
+      Deliver(sender, subscribers[i], topic, payload);
+    }
+  }
+  void Send(const BaseComponent *sender, ComponentId target, TopicId topic, std::uint64_t payload) override {
+    Deliver(sender, target, topic, payload);
+  }
+
+  void Start(unsigned workers) {
+    running_ = true;
+    for (unsigned i = 0; i < workers; i++) {
+      workers_.push_back(std::thread(&LockedMediator::WorkerLoop, this));
+    }
+  }
+  void Wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_.wait(lock, [this] { return queue_.empty() && in_flight_ == 0; });
+  }
+  void Stop() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      running_ = false;
+    }
+    not_empty_.notify_all();
+    for (std::size_t i = 0; i < workers_.size(); i++) {
+      workers_[i].join();
+    }
+    workers_.clear();
+  }
+};
+
+/**
+ * Темы примера из основного файла.
+ */
+struct DemoTopics {
+  TopicId a;
+  TopicId b;
+  TopicId c;
+  TopicId d;
+};
+
+/**
+ * Компоненты основного примера. Реакции, которые раньше были зашиты в
+ * ConcreteMediator, теперь — подписки на темы.
+ */
+class Component1 : public BaseComponent {
+ private:
+  const DemoTopics &topics_;
+
+ public:
+  explicit Component1(const DemoTopics &topics) : topics_(topics) {
+  }
+  void DoA() {
+    std::cout << "Component 1 does A.\n";
+    this->mediator_->Publish(this, topics_.a, 0);
+  }
+  void DoB() {
+    std::cout << "Component 1 does B.\n";
+    this->mediator_->Publish(this, topics_.b, 0);
+  }
+  void Receive(const Message &message) override {
+    if (message.topic == topics_.d) {
+      std::cout << "Component 1 reacts on D:\n";
+      DoB();
+    }
+  }
+};
+
+class Component2 : public BaseComponent {
+ private:
+  const DemoTopics &topics_;
+
+ public:
+  explicit Component2(const DemoTopics &topics) : topics_(topics) {
+  }
+  void DoC() {
+    std::cout << "Component 2 does C.\n";
+    this->mediator_->Publish(this, topics_.c, 0);
+  }
+  void DoD() {
+    std::cout << "Component 2 does D.\n";
+    this->mediator_->Publish(this, topics_.d, 0);
+  }
+  void Receive(const Message &message) override {
+    if (message.topic == topics_.a || message.topic == topics_.d) {
+      std::cout << "Component 2 reacts on " << (message.topic == topics_.a ? "A" : "D") << ":\n";
+      DoC();
+    }
+  }
+};
+
+/**
+ * Клиентский код.
+ */
+
+void ClientCode() {
+  RoutingMediator mediator(1);
+  DemoTopics topics;
+  topics.a = mediator.AddTopic("A");
+  topics.b = mediator.AddTopic("B");
+  topics.c = mediator.AddTopic("C");
+  topics.d = mediator.AddTopic("D");
+  Component1 c1(topics);
+  Component2 c2(topics);
+  mediator.Register(&c1);
+  mediator.Register(&c2);
+  mediator.Subscribe(c2.id(), topics.a);
+  mediator.Subscribe(c1.id(), topics.d);
+  mediator.Subscribe(c2.id(), topics.d);
+
+  std::cout << "Client triggers operation A.\n";
+  c1.DoA();
+  mediator.Drain();
+  std::cout << "\n";
+  std::cout << "Client triggers operation D.\n";
+  c2.DoD();
+  mediator.Drain();
+  std::cout << "\n";
+}
+
+/**
+ * Компонент для нагрузочного теста. Сообщение темы forward с ненулевым
+ * payload компонент пересылает случайному компоненту, уменьшив payload на
+ * единицу, — так часть трафика порождают сами компоненты.
+ */
+class TrafficComponent : public BaseComponent {
+ private:
+  std::size_t component_count_;
+  TopicId forward_;
+
+ public:
+  std::atomic<std::uint64_t> received;
+
+  TrafficComponent(std::size_t component_count, TopicId forward)
+      : component_count_(component_count), forward_(forward), received(0) {
+  }
+  void Receive(const Message &message) override {
+    received.fetch_add(1, std::memory_order_relaxed);
+    if (message.topic == forward_ && message.payload > 0) {
+      std::uint64_t x = message.payload * 0x9E3779B97F4A7C15ULL + id_;
+      ComponentId target = static_cast<ComponentId>((x >> 32) % component_count_);
+      this->mediator_->Send(this, target, forward_, message.payload - 1);
+    }
+  }
+};
+
+/**
+ * Смешанный трафик: 90% сообщений — личные (из них четверть пересылается
+ * ещё трижды), 10% — публикации в одну из групповых тем по group_size
+ * подписчиков.
+ */
+template <typename MediatorType>
+void SendTraffic(MediatorType &mediator, std::vector<std::unique_ptr<TrafficComponent> > &components,
+                 TopicId forward, TopicId first_group, std::size_t groups, unsigned producers,
+                 std::size_t messages_per_producer) {
+  std::vector<std::thread> threads;
+  for (unsigned p = 0; p < producers; p++) {
+    threads.push_back(std::thread([&, p] {
+      std::uint64_t state = 0x2545F4914F6CDD1DULL * (p + 1);
+      for (std::size_t i = 0; i < messages_per_producer; i++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        const TrafficComponent *sender = components[state % components.size()].get();
+        if (state % 10 != 0) {
+          ComponentId target = static_cast<ComponentId>((state >> 20) % components.size());
+          mediator.Send(sender, target, forward, (state >> 8) % 4 == 0 ? 3 : 0);
+        } else {
+          mediator.Publish(sender, first_group + static_cast<TopicId>((state >> 20) % groups), 0);
+        }
+      }
+    }));
+  }
+  for (std::size_t i = 0; i < threads.size(); i++) {
+    threads[i].join();
+  }
+}
+
+template <typename MediatorType, typename AddTopic, typename Start>
+void RunBenchmark(const char *name, MediatorType &mediator, AddTopic add_topic, Start start, std::size_t count,
+                  std::size_t group_size, unsigned producers, std::size_t messages_per_producer) {
+  typedef std::chrono::steady_clock Clock;
+  TopicId forward = add_topic();
+  std::size_t groups = count / group_size;
+  TopicId first_group = add_topic();
+  for (std::size_t g = 1; g < groups; g++) {
+    add_topic();
+  }
+  std::vector<std::unique_ptr<TrafficComponent> > components;
+  for (std::size_t i = 0; i < count; i++) {
+    components.push_back(std::unique_ptr<TrafficComponent>(new TrafficComponent(count, forward)));
+    ComponentId id = mediator.Register(components.back().get());
+    mediator.Subscribe(id, first_group + static_cast<TopicId>(i % groups));
+  }
+
+  start();
+  Clock::time_point begin = Clock::now();
+  SendTraffic(mediator, components, forward, first_group, groups, producers, messages_per_producer);
+  mediator.Wait();
+  double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+  mediator.Stop();
+
+  std::uint64_t delivered = 0;
+  for (std::size_t i = 0; i < components.size(); i++) {
+    delivered += components[i]->received.load();
+  }
+  std::cout << name << delivered << " messages delivered in " << seconds * 1e3 << " ms, "
+            << delivered / seconds / 1e6 << " M messages/s\n";
+}
+
+int main(int argc, char *argv[]) {
+  ClientCode();
+
+  std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000;
+  std::size_t messages = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 250000;
+  unsigned producers = 4;
+  unsigned workers = 4;
+  const std::size_t kGroupSize = 16;
+  std::cout << "Benchmark: " << count << " components, " << count / kGroupSize << " group topics, " << producers
+            << " producers x " << messages << " messages, " << workers << " workers\n";
+  {
+    RoutingMediator mediator(workers);
+    RunBenchmark("mailboxes:    ", mediator, [&] { return mediator.AddTopic(std::to_string(mediator.topics())); },
+                 [&] { mediator.Start(); }, count, kGroupSize, producers, messages);
+  }
+  {
+    LockedMediator mediator;
+    RunBenchmark("locked queue: ", mediator, [&] { return mediator.AddTopic(); }, [&] { mediator.Start(workers); },
+                 count, kGroupSize, producers, messages);
+  }
+  // Почтовые ящики выигрывают, когда рабочие потоки и отправители идут на
+  // разных ядрах. На одном ядре они только делят его, и атомарные операции
+  // на каждое сообщение обходятся дороже одной блокировки на пачку.
+  unsigned cpus = std::thread::hardware_concurrency();
+  if (cpus != 0 && cpus < workers) {
+    std::cout << "Note: only " << cpus << " CPU(s) for " << producers << " producers and " << workers
+              << " workers: the threads share cores, so this run favours the locked queue\n";
+  }
+  return 0;
+}
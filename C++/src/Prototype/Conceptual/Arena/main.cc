@@ -0,0 +1,389 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <set>
+#include <string>
+#include <vector>
+
+using std::string;
+
+// Паттерн Прототип
+//
+// Назначение: Позволяет копировать объекты, не вдаваясь в подробности их
+// реализации.
+//
+// Clone из основного примера каждый раз выделяет память в куче. Этот вариант
+// добавляет CloneInto, который создаёт копию в памяти, предоставленной
+// вызывающим кодом. На его основе сделаны арена, из которой клоны
+// выделяются сдвигом указателя и освобождаются все разом, и пакетное
+// клонирование N копий в один непрерывный участок памяти.
+
+enum Type {
+  PROTOTYPE_1 = 0,
+  PROTOTYPE_2,
+  PROTOTYPE_COUNT
+};
+
+class Prototype {
+ protected:
+  string prototype_name_;
+  float prototype_field_;
+
+ public:
+  Prototype() {}
+  Prototype(string prototype_name)
+      : prototype_name_(prototype_name) {
+  }
+  virtual ~Prototype() {}
+  virtual Prototype *Clone() const = 0;
+  /**
+   * Создаёт копию в storage. storage должен вмещать size() байт и быть
+   * выровнен на alignment(). Освобождать клон нужно явным вызовом
+   * деструктора, а не delete.
+   */
+  virtual Prototype *CloneInto(void *storage) const = 0;
+  /**
+   * Создаёт count копий подряд, с шагом size() байт, и возвращает первую.
+   */
+  virtual Prototype *CloneBatchInto(void *storage, std::size_t count) const = 0;
+  virtual std::size_t size() const = 0;
+  virtual std::size_t alignment() const = 0;
+  virtual void Method(float prototype_field) {
+    this->prototype_field_ = prototype_field;
+    std::cout << "Call Method from " << prototype_name_ << " with field : " << prototype_field << std::endl;
+  }
+};
+
+/**
+ * Общая реализация клонирования для конкретных прототипов, чтобы не
+ * повторять её в каждом классе.
+ */
+template <typename Derived>
+class ClonablePrototype : public Prototype {
+ public:
+  explicit ClonablePrototype(string prototype_name) : Prototype(prototype_name) {
+  }
+  Prototype *Clone() const override {
+    return new Derived(static_cast<const Derived &>(*this));
+  }
+  Prototype *CloneInto(void *storage) const override {
+    return new (storage) Derived(static_cast<const Derived &>(*this));
+  }
+  Prototype *CloneBatchInto(void *storage, std::size_t count) const override {
+    Derived *first = static_cast<Derived *>(storage);
+    for (std::size_t i = 0; i < count; i++) {
+      new (first + i) Derived(static_cast<const Derived &>(*this));
+    }
+    return first;
+  }
+  std::size_t size() const override {
+    return sizeof(Derived);
+  }
+  std::size_t alignment() const override {
+    return alignof(Derived);
+  }
+};
+
+class ConcretePrototype1 : public ClonablePrototype<ConcretePrototype1> {
+ private:
+  float concrete_prototype_field1_;
+
+ public:
+  ConcretePrototype1(string prototype_name, float concrete_prototype_field)
+      : ClonablePrototype(prototype_name), concrete_prototype_field1_(concrete_prototype_field) {
+  }
+};
+
+class ConcretePrototype2 : public ClonablePrototype<ConcretePrototype2> {
+ private:
+  float concrete_prototype_field2_;
+
+ public:
+  ConcretePrototype2(string prototype_name, float concrete_prototype_field)
+      : ClonablePrototype(prototype_name), concrete_prototype_field2_(concrete_prototype_field) {
+  }
+};
+
+/**
+ * Арена: память берётся блоками и раздаётся сдвигом указателя. Отдельный
+ * объект освободить нельзя; Reset вызывает деструкторы всех объектов и
+ * оставляет блоки для повторного использования. Запрос больше блока
+ * получает собственный участок, который Reset возвращает системе.
+ */
+class Arena {
+ private:
+  static const std::size_t kBlockSize = 64 * 1024;
+
+  std::vector<char *> blocks_;
+  std::vector<char *> large_blocks_;
+  std::size_t large_bytes_;
+  std::size_t current_block_;
+  std::size_t offset_;
+  std::size_t used_bytes_;
+  std::vector<Prototype *> objects_;
+
+ public:
+  Arena() : large_bytes_(0), current_block_(0), offset_(0), used_bytes_(0) {
+  }
+  ~Arena() {
+    Reset();
+    for (std::size_t i = 0; i < blocks_.size(); i++) {
+      std::free(blocks_[i]);
+    }
+  }
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  void *Allocate(std::size_t size, std::size_t alignment) {
+    if (size > kBlockSize / 4) {
+      char *block = static_cast<char *>(NewBlock(size));
+      large_blocks_.push_back(block);
+      large_bytes_ += size;
+      used_bytes_ += size;
+      return block;
+    }
+    for (;;) {
+      if (current_block_ < blocks_.size()) {
+        std::size_t start = (offset_ + alignment - 1) / alignment * alignment;
+        if (start + size <= kBlockSize) {
+          offset_ = start + size;
+          used_bytes_ += size;
+          return blocks_[current_block_] + start;
+        }
+        current_block_++;
+        offset_ = 0;
+        continue;
+      }
+      blocks_.push_back(static_cast<char *>(NewBlock(kBlockSize)));
+    }
+  }
+
+  /**
+   * Запоминает объект, чтобы Reset вызвал его деструктор.
+   */
+  void Track(Prototype *object) {
+    objects_.push_back(object);
+  }
+
+  void Reset() {
+    for (std::size_t i = 0; i < objects_.size(); i++) {
+      objects_[i]->~Prototype();
+    }
+    objects_.clear();
+    for (std::size_t i = 0; i < large_blocks_.size(); i++) {
+      std::free(large_blocks_[i]);
+    }
+    large_blocks_.clear();
+    large_bytes_ = 0;
+    current_block_ = 0;
+    offset_ = 0;
+    used_bytes_ = 0;
+  }
+
+  std::size_t used_bytes() const {
+    return used_bytes_;
+  }
+  std::size_t reserved_bytes() const {
+    return blocks_.size() * kBlockSize + large_bytes_;
+  }
+
+ private:
+  /**
+   * malloc выравнивает на alignof(std::max_align_t), этого хватает
+   * прототипам.
+   */
+  static void *NewBlock(std::size_t size) {
+    void *block = std::malloc(size);
+    if (block == nullptr) {
+      throw std::bad_alloc();
+    }
+    return block;
+  }
+};
+
+/**
+ * Клоны, лежащие подряд с шагом stride байт. Адрес i-го клона вычисляется
+ * здесь, чтобы вызывающему коду не нужно было считать его самому.
+ * Действителен до Reset арены, в которой лежат клоны.
+ */
+class PrototypeBatch {
+ private:
+  char *first_;
+  std::size_t stride_;
+  std::size_t count_;
+
+ public:
+  PrototypeBatch(void *first, std::size_t stride, std::size_t count)
+      : first_(static_cast<char *>(first)), stride_(stride), count_(count) {
+  }
+  Prototype *operator[](std::size_t i) const {
+    return reinterpret_cast<Prototype *>(first_ + i * stride_);
+  }
+  std::size_t size() const {
+    return count_;
+  }
+};
+
+/**
+ * Своя арена у каждого потока, поэтому выделение из неё не требует
+ * синхронизации.
+ */
+Arena &ThreadArena() {
+  static thread_local Arena arena;
+  return arena;
+}
+
+class PrototypeFactory {
+ private:
+  Prototype *prototypes_[PROTOTYPE_COUNT];
+
+ public:
+  PrototypeFactory() {
+    prototypes_[Type::PROTOTYPE_1] = new ConcretePrototype1("PROTOTYPE_1 ", 50.f);
+    prototypes_[Type::PROTOTYPE_2] = new ConcretePrototype2("PROTOTYPE_2 ", 60.f);
+  }
+  ~PrototypeFactory() {
+    for (int type = 0; type < PROTOTYPE_COUNT; type++) {
+      delete prototypes_[type];
+    }
+  }
+
+  Prototype *CreatePrototype(Type type) const {
+    return prototypes_[type]->Clone();
+  }
+
+  /**
+   * Клон в арене. Освобождается вместе со всей ареной при Reset.
+   */
+  Prototype *CreatePrototype(Type type, Arena *arena) const {
+    const Prototype *prototype = prototypes_[type];
+    Prototype *clone = prototype->CloneInto(arena->Allocate(prototype->size(), prototype->alignment()));
+    arena->Track(clone);
+    return clone;
+  }
+
+  /**
+   * count клонов подряд в одном участке арены.
+   */
+  PrototypeBatch CreatePrototypes(Type type, std::size_t count, Arena *arena) const {
+    const Prototype *prototype = prototypes_[type];
+    void *storage = arena->Allocate(prototype->size() * count, prototype->alignment());
+    prototype->CloneBatchInto(storage, count);
+    PrototypeBatch batch(storage, prototype->size(), count);
+    for (std::size_t i = 0; i < batch.size(); i++) {
+      arena->Track(batch[i]);
+    }
+    return batch;
+  }
+};
+
+void Client(PrototypeFactory &prototype_factory) {
+  Arena &arena = ThreadArena();
+  std::cout << "Let's create a Prototype 1 in the thread arena\n";
+  Prototype *prototype = prototype_factory.CreatePrototype(Type::PROTOTYPE_1, &arena);
+  prototype->Method(90);
+
+  std::cout << "\nLet's create 3 Prototype 2 clones in one contiguous block\n";
+  PrototypeBatch batch = prototype_factory.CreatePrototypes(Type::PROTOTYPE_2, 3, &arena);
+  for (std::size_t i = 0; i < batch.size(); i++) {
+    batch[i]->Method(static_cast<float>(10 * (i + 1)));
+  }
+  std::cout << "Arena holds " << arena.used_bytes() << " bytes; releasing all clones at once\n\n";
+  arena.Reset();
+}
+
+/**
+ * Число различных страниц памяти, на которых лежат клоны. Чем их меньше,
+ * тем плотнее клоны упакованы и тем меньше промахов TLB и кэша при их
+ * обходе.
+ */
+std::size_t PagesTouched(const std::vector<Prototype *> &clones, std::size_t object_size) {
+  std::set<std::uintptr_t> pages;
+  for (std::size_t i = 0; i < clones.size(); i++) {
+    std::uintptr_t address = reinterpret_cast<std::uintptr_t>(clones[i]);
+    pages.insert(address / 4096);
+    pages.insert((address + object_size - 1) / 4096);
+  }
+  return pages.size();
+}
+
+void Benchmark(std::size_t count, int rounds) {
+  PrototypeFactory factory;
+  Arena &arena = ThreadArena();
+  std::vector<Prototype *> clones(count);
+  std::size_t object_size = sizeof(ConcretePrototype1);
+  typedef std::chrono::steady_clock Clock;
+
+  std::cout << "Benchmark: " << rounds << " rounds of " << count << " clones of " << object_size << " bytes\n";
+
+  Clock::time_point start = Clock::now();
+  for (int r = 0; r < rounds; r++) {
+    for (std::size_t i = 0; i < count; i++) {
+      clones[i] = factory.CreatePrototype(Type::PROTOTYPE_1);
+    }
+    for (std::size_t i = 0; i < count; i++) {
+      delete clones[i];
+    }
+  }
+  double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  std::cout << "new/delete each clone:     " << count * rounds / seconds / 1e6 << " M clones/s\n";
+
+  start = Clock::now();
+  for (int r = 0; r < rounds; r++) {
+    for (std::size_t i = 0; i < count; i++) {
+      clones[i] = factory.CreatePrototype(Type::PROTOTYPE_1, &arena);
+    }
+    arena.Reset();
+  }
+  seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  std::cout << "thread arena, bulk Reset:  " << count * rounds / seconds / 1e6 << " M clones/s\n";
+
+  start = Clock::now();
+  for (int r = 0; r < rounds; r++) {
+    factory.CreatePrototypes(Type::PROTOTYPE_1, count, &arena);
+    arena.Reset();
+  }
+  seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  std::cout << "batch into contiguous:     " << count * rounds / seconds / 1e6 << " M clones/s\n";
+
+  // Раскладка в памяти. В настоящей программе между клонами выделяется
+  // что-то ещё; это имитируют строки случайной длины.
+  std::vector<string *> noise;
+  std::srand(7);
+  for (std::size_t i = 0; i < count; i++) {
+    clones[i] = factory.CreatePrototype(Type::PROTOTYPE_1);
+    noise.push_back(new string(16 + std::rand() % 200, 'x'));
+  }
+  std::size_t heap_pages = PagesTouched(clones, object_size);
+  for (std::size_t i = 0; i < count; i++) {
+    delete clones[i];
+    delete noise[i];
+  }
+  for (std::size_t i = 0; i < count; i++) {
+    clones[i] = factory.CreatePrototype(Type::PROTOTYPE_1, &arena);
+    noise.push_back(new string(16 + std::rand() % 200, 'x'));
+  }
+  std::size_t arena_pages = PagesTouched(clones, object_size);
+  std::size_t ideal_pages = (count * object_size + 4095) / 4096;
+  std::cout << "\nPages holding " << count << " clones (ideal " << ideal_pages << "): heap " << heap_pages
+            << ", arena " << arena_pages << "\n";
+  std::cout << "Arena: " << arena.used_bytes() << " bytes used of " << arena.reserved_bytes() << " reserved ("
+            << 100.0 * (arena.reserved_bytes() - arena.used_bytes()) / arena.reserved_bytes() << "% unused)\n";
+  arena.Reset();
+  for (std::size_t i = count; i < noise.size(); i++) {
+    delete noise[i];
+  }
+}
+
+int main(int argc, char *argv[]) {
+  PrototypeFactory *prototype_factory = new PrototypeFactory();
+  Client(*prototype_factory);
+  delete prototype_factory;
+
+  std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000;
+  Benchmark(count, 500);
+  return 0;
+}
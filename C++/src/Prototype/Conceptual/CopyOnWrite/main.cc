@@ -0,0 +1,256 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+using std::string;
+
+// Паттерн Прототип
+//
+// Назначение: Позволяет копировать объекты, не вдаваясь в подробности их
+// реализации.
+//
+// Клоны почти никогда не меняют имя и описание прототипа, но Clone каждый
+// раз копирует их целиком. В этом варианте тяжёлые поля хранятся в
+// CowString — строке с копированием при записи. Клон разделяет строку с
+// прототипом, и клонирование стоит одного увеличения счётчика ссылок; копию
+// строки делает только тот клон, который её меняет.
+
+/**
+ * Счётчики выделений памяти, чтобы посчитать, сколько памяти занимают
+ * клоны. operator new и operator delete не встраиваются: иначе GCC видит
+ * free для указателя от malloc и предупреждает о несовпадении.
+ */
+static std::size_t g_allocations = 0;
+static std::size_t g_allocated_bytes = 0;
+
+__attribute__((noinline)) void *operator new(std::size_t size) {
+  g_allocations++;
+  g_allocated_bytes += size;
+  void *p = std::malloc(size == 0 ? 1 : size);
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept {
+  std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void *p, std::size_t) noexcept {
+  std::free(p);
+}
+
+/**
+ * Строка с копированием при записи. Копия CowString разделяет с оригиналом
+ * одну неизменяемую строку. mutable_value() перед изменением делает
+ * собственную копию, если строку разделяет кто-то ещё.
+ *
+ * Читать разные CowString, разделяющие строку, можно из разных потоков.
+ * mutable_value — только в однопоточном коде: use_count() читается без
+ * синхронизации (по той же причине устарел shared_ptr::unique), и поток
+ * может увидеть 1 и начать писать, пока другой поток ещё читает строку.
+ */
+class CowString {
+ private:
+  std::shared_ptr<string> value_;
+
+ public:
+  CowString() : value_(std::make_shared<string>()) {
+  }
+  CowString(const string &value) : value_(std::make_shared<string>(value)) {
+  }
+  CowString(const char *value) : value_(std::make_shared<string>(value)) {
+  }
+
+  const string &value() const {
+    return *value_;
+  }
+
+  /**
+   * Заменяет значение целиком. Копировать старую строку не нужно: вместо
+   * неё создаётся новая.
+   */
+  void assign(const string &value) {
+    value_ = std::make_shared<string>(value);
+  }
+
+  string &mutable_value() {
+    if (value_.use_count() > 1) {
+      value_ = std::make_shared<string>(*value_);
+    }
+    return *value_;
+  }
+
+  bool shares_with(const CowString &other) const {
+    return value_ == other.value_;
+  }
+};
+
+std::ostream &operator<<(std::ostream &out, const CowString &value) {
+  return out << value.value();
+}
+
+enum Type {
+  PROTOTYPE_1 = 0,
+  PROTOTYPE_2,
+  PROTOTYPE_COUNT
+};
+
+class Prototype {
+ protected:
+  CowString prototype_name_;
+  CowString prototype_description_;
+  float prototype_field_;
+
+ public:
+  Prototype() {}
+  Prototype(string prototype_name, string prototype_description)
+      : prototype_name_(prototype_name), prototype_description_(prototype_description) {
+  }
+  virtual ~Prototype() {}
+  virtual Prototype *Clone() const = 0;
+  virtual void Method(float prototype_field) {
+    this->prototype_field_ = prototype_field;
+    std::cout << "Call Method from " << prototype_name_ << " with field : " << prototype_field << std::endl;
+  }
+  void Rename(const string &prototype_name) {
+    prototype_name_.assign(prototype_name);
+  }
+  const CowString &name() const {
+    return prototype_name_;
+  }
+  const CowString &description() const {
+    return prototype_description_;
+  }
+};
+
+class ConcretePrototype1 : public Prototype {
+ private:
+  float concrete_prototype_field1_;
+
+ public:
+  ConcretePrototype1(string prototype_name, string prototype_description, float concrete_prototype_field)
+      : Prototype(prototype_name, prototype_description), concrete_prototype_field1_(concrete_prototype_field) {
+  }
+  Prototype *Clone() const override {
+    return new ConcretePrototype1(*this);
+  }
+};
+
+class ConcretePrototype2 : public Prototype {
+ private:
+  float concrete_prototype_field2_;
+
+ public:
+  ConcretePrototype2(string prototype_name, string prototype_description, float concrete_prototype_field)
+      : Prototype(prototype_name, prototype_description), concrete_prototype_field2_(concrete_prototype_field) {
+  }
+  Prototype *Clone() const override {
+    return new ConcretePrototype2(*this);
+  }
+};
+
+/**
+ * Прототип в прежнем виде, с обычными строками, для сравнения.
+ */
+class DeepCopyPrototype {
+ private:
+  string prototype_name_;
+  string prototype_description_;
+  float prototype_field_;
+
+ public:
+  DeepCopyPrototype(string prototype_name, string prototype_description, float prototype_field)
+      : prototype_name_(prototype_name), prototype_description_(prototype_description),
+        prototype_field_(prototype_field) {
+  }
+  virtual ~DeepCopyPrototype() {}
+  virtual DeepCopyPrototype *Clone() const {
+    return new DeepCopyPrototype(*this);
+  }
+};
+
+/**
+ * Описание прототипа: в реальной программе это могли бы быть настройки,
+ * шаблон текста и т. п. Оно длиннее буфера короткой строки, поэтому обычная
+ * std::string при каждом копировании выделяет под него память.
+ */
+static const char kDescription[] =
+    "A prototype with a long, rarely changed description that every clone used to copy. "
+    "Copy-on-write lets all clones share a single instance of it until one of them needs "
+    "its own version.";
+
+class PrototypeFactory {
+ private:
+  Prototype *prototypes_[PROTOTYPE_COUNT];
+
+ public:
+  PrototypeFactory() {
+    prototypes_[Type::PROTOTYPE_1] = new ConcretePrototype1("PROTOTYPE_1 ", kDescription, 50.f);
+    prototypes_[Type::PROTOTYPE_2] = new ConcretePrototype2("PROTOTYPE_2 ", kDescription, 60.f);
+  }
+  ~PrototypeFactory() {
+    for (int type = 0; type < PROTOTYPE_COUNT; type++) {
+      delete prototypes_[type];
+    }
+  }
+  Prototype *CreatePrototype(Type type) const {
+    return prototypes_[type]->Clone();
+  }
+};
+
+void Client(PrototypeFactory &prototype_factory) {
+  std::cout << "Let's create two Prototype 1 clones\n";
+  Prototype *first = prototype_factory.CreatePrototype(Type::PROTOTYPE_1);
+  Prototype *second = prototype_factory.CreatePrototype(Type::PROTOTYPE_1);
+  std::cout << "Clones share the name: " << (first->name().shares_with(second->name()) ? "yes" : "no") << "\n";
+
+  second->Rename("RENAMED_1 ");
+  first->Method(90);
+  second->Method(10);
+  std::cout << "After rename they share the name: " << (first->name().shares_with(second->name()) ? "yes" : "no")
+            << ", the description: " << (first->description().shares_with(second->description()) ? "yes" : "no")
+            << "\n\n";
+  delete first;
+  delete second;
+}
+
+template <typename T, typename Create>
+void Measure(const char *name, Create create, std::size_t count) {
+  std::vector<T *> clones;
+  clones.reserve(count);
+  std::size_t allocations = g_allocations;
+  std::size_t bytes = g_allocated_bytes;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < count; i++) {
+    clones.push_back(create());
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  allocations = g_allocations - allocations;
+  bytes = g_allocated_bytes - bytes;
+  std::cout << name << count / seconds / 1e6 << " M clones/s, " << static_cast<double>(allocations) / count
+            << " allocations/clone, " << bytes / (1024.0 * 1024.0) << " MB for " << count << " clones\n";
+  for (std::size_t i = 0; i < count; i++) {
+    delete clones[i];
+  }
+}
+
+int main(int argc, char *argv[]) {
+  PrototypeFactory *prototype_factory = new PrototypeFactory();
+  Client(*prototype_factory);
+
+  std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+  DeepCopyPrototype deep("PROTOTYPE_1 ", kDescription, 50.f);
+  std::cout << "Benchmark: description of " << sizeof(kDescription) - 1 << " characters\n";
+  Measure<DeepCopyPrototype>("deep copy:     ", [&] { return deep.Clone(); }, count);
+  Measure<Prototype>("copy-on-write: ", [&] { return prototype_factory->CreatePrototype(Type::PROTOTYPE_1); },
+                     count);
+  delete prototype_factory;
+  return 0;
+}
@@ -0,0 +1,322 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using std::string;
+
+// Паттерн Прототип
+//
+// Назначение: Позволяет копировать объекты, не вдаваясь в подробности их
+// реализации.
+//
+// Этот вариант сравнивает способы хранения прототипов в фабрике: хеш-таблицу
+// (как было в основном примере), массив, индексируемый перечислением Type,
+// и расширяемый реестр, в который плагины добавляют свои типы во время
+// работы программы. Плагин получает плотный числовой идентификатор, поэтому
+// клонирование и для него сводится к обращению по индексу; поиск по имени
+// нужен только один раз, при регистрации.
+
+enum Type {
+  PROTOTYPE_1 = 0,
+  PROTOTYPE_2,
+  PROTOTYPE_COUNT
+};
+
+class Prototype {
+ protected:
+  string prototype_name_;
+  float prototype_field_;
+
+ public:
+  Prototype() {}
+  Prototype(string prototype_name)
+      : prototype_name_(prototype_name) {
+  }
+  virtual ~Prototype() {}
+  virtual Prototype *Clone() const = 0;
+  virtual void Method(float prototype_field) {
+    this->prototype_field_ = prototype_field;
+    std::cout << "Call Method from " << prototype_name_ << " with field : " << prototype_field << std::endl;
+  }
+  const string &name() const {
+    return prototype_name_;
+  }
+};
+
+class ConcretePrototype1 : public Prototype {
+ private:
+  float concrete_prototype_field1_;
+
+ public:
+  ConcretePrototype1(string prototype_name, float concrete_prototype_field)
+      : Prototype(prototype_name), concrete_prototype_field1_(concrete_prototype_field) {
+  }
+  Prototype *Clone() const override {
+    return new ConcretePrototype1(*this);
+  }
+};
+
+class ConcretePrototype2 : public Prototype {
+ private:
+  float concrete_prototype_field2_;
+
+ public:
+  ConcretePrototype2(string prototype_name, float concrete_prototype_field)
+      : Prototype(prototype_name), concrete_prototype_field2_(concrete_prototype_field) {
+  }
+  Prototype *Clone() const override {
+    return new ConcretePrototype2(*this);
+  }
+};
+
+/**
+ * Тип, который в реальной программе пришёл бы из плагина: основной код о
+ * нём ничего не знает.
+ */
+class PluginPrototype : public Prototype {
+ private:
+  int plugin_field_;
+
+ public:
+  PluginPrototype(string prototype_name, int plugin_field) : Prototype(prototype_name), plugin_field_(plugin_field) {
+  }
+  Prototype *Clone() const override {
+    return new PluginPrototype(*this);
+  }
+};
+
+/**
+ * Фабрика в прежнем виде: прототипы в unordered_map. Оставлена для
+ * сравнения. operator[] на каждое клонирование считает хеш, проходит по
+ * цепочке корзины и, если ключа нет, вставляет пустую запись.
+ */
+class HashPrototypeFactory {
+ private:
+  std::unordered_map<Type, Prototype *, std::hash<int>> prototypes_;
+
+ public:
+  HashPrototypeFactory() {
+    prototypes_[Type::PROTOTYPE_1] = new ConcretePrototype1("PROTOTYPE_1 ", 50.f);
+    prototypes_[Type::PROTOTYPE_2] = new ConcretePrototype2("PROTOTYPE_2 ", 60.f);
+  }
+  ~HashPrototypeFactory() {
+    delete prototypes_[Type::PROTOTYPE_1];
+    delete prototypes_[Type::PROTOTYPE_2];
+  }
+  Prototype *CreatePrototype(Type type) {
+    return prototypes_[type]->Clone();
+  }
+  const Prototype *Find(Type type) {
+    return prototypes_[type];
+  }
+};
+
+/**
+ * Фабрика из основного примера: массив, индексируемый типом.
+ */
+class PrototypeFactory {
+ private:
+  Prototype *prototypes_[PROTOTYPE_COUNT];
+
+ public:
+  PrototypeFactory() {
+    prototypes_[Type::PROTOTYPE_1] = new ConcretePrototype1("PROTOTYPE_1 ", 50.f);
+    prototypes_[Type::PROTOTYPE_2] = new ConcretePrototype2("PROTOTYPE_2 ", 60.f);
+  }
+  ~PrototypeFactory() {
+    for (int type = 0; type < PROTOTYPE_COUNT; type++) {
+      delete prototypes_[type];
+    }
+  }
+  /**
+   * Бросает std::out_of_range для значения вне перечисления.
+   */
+  Prototype *CreatePrototype(Type type) const {
+    return Find(type)->Clone();
+  }
+  template <Type type>
+  Prototype *CreatePrototype() const {
+    static_assert(type >= 0 && type < PROTOTYPE_COUNT, "unknown prototype type");
+    return prototypes_[type]->Clone();
+  }
+  const Prototype *Find(Type type) const {
+    if (type < 0 || type >= PROTOTYPE_COUNT) {
+      throw std::out_of_range("PrototypeFactory: unknown prototype type " + std::to_string(type));
+    }
+    return prototypes_[type];
+  }
+};
+
+/**
+ * Расширяемый реестр. Встроенные типы занимают идентификаторы 0 ..
+ * PROTOTYPE_COUNT - 1, типы плагинов получают следующие по порядку. Все
+ * прототипы лежат в одном векторе, индекс в котором и есть идентификатор.
+ * Имена нужны только для того, чтобы плагины и конфигурация находили
+ * идентификатор; на горячем пути их не ищут.
+ */
+class PrototypeRegistry {
+ private:
+  std::vector<Prototype *> prototypes_;
+  std::unordered_map<string, int> ids_;
+
+ public:
+  PrototypeRegistry() : prototypes_(PROTOTYPE_COUNT, nullptr) {
+    prototypes_[Type::PROTOTYPE_1] = new ConcretePrototype1("PROTOTYPE_1 ", 50.f);
+    prototypes_[Type::PROTOTYPE_2] = new ConcretePrototype2("PROTOTYPE_2 ", 60.f);
+    ids_["PROTOTYPE_1"] = Type::PROTOTYPE_1;
+    ids_["PROTOTYPE_2"] = Type::PROTOTYPE_2;
+  }
+  ~PrototypeRegistry() {
+    for (std::size_t id = 0; id < prototypes_.size(); id++) {
+      delete prototypes_[id];
+    }
+  }
+
+  /**
+   * Регистрирует прототип плагина и возвращает его идентификатор. Реестр
+   * становится владельцем прототипа.
+   */
+  int Register(const string &name, Prototype *prototype) {
+    if (ids_.count(name) != 0) {
+      delete prototype;
+      throw std::invalid_argument("PrototypeRegistry: duplicate prototype " + name);
+    }
+    int id = static_cast<int>(prototypes_.size());
+    prototypes_.push_back(prototype);
+    ids_[name] = id;
+    return id;
+  }
+
+  /**
+   * Возвращает идентификатор по имени или -1, если такого прототипа нет.
+   */
+  int FindId(const string &name) const {
+    std::unordered_map<string, int>::const_iterator it = ids_.find(name);
+    return it == ids_.end() ? -1 : it->second;
+  }
+
+  /**
+   * Бросает std::out_of_range для неизвестного идентификатора, в том числе
+   * для -1 от FindId.
+   */
+  Prototype *CreatePrototype(int id) const {
+    return Find(id)->Clone();
+  }
+  const Prototype *Find(int id) const {
+    if (id < 0 || static_cast<std::size_t>(id) >= prototypes_.size()) {
+      throw std::out_of_range("PrototypeRegistry: unknown prototype id " + std::to_string(id));
+    }
+    return prototypes_[id];
+  }
+  std::size_t size() const {
+    return prototypes_.size();
+  }
+};
+
+void Client(PrototypeRegistry &registry) {
+  int plugin = registry.Register("PLUGIN_1", new PluginPrototype("PLUGIN_1 ", 7));
+  std::cout << "Registered PLUGIN_1 with id " << plugin << "\n";
+
+  const char *names[] = {"PROTOTYPE_1", "PROTOTYPE_2", "PLUGIN_1", "PLUGIN_2"};
+  for (const char *name : names) {
+    int id = registry.FindId(name);
+    if (id < 0) {
+      std::cout << name << " is not registered\n";
+      continue;
+    }
+    Prototype *prototype = registry.CreatePrototype(id);
+    prototype->Method(90);
+    delete prototype;
+  }
+  std::cout << "\n";
+}
+
+static volatile std::uintptr_t g_sink;
+
+/**
+ * Сначала измеряется только поиск прототипа (без копирования), затем
+ * полное клонирование с освобождением клона. Порядок типов случайный,
+ * чтобы предсказатель переходов не угадал его.
+ */
+template <typename Lookup>
+double MeasureLookups(Lookup lookup, const std::vector<int> &ids, int rounds) {
+  std::uintptr_t sink = 0;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (int r = 0; r < rounds; r++) {
+    for (std::size_t i = 0; i < ids.size(); i++) {
+      sink ^= reinterpret_cast<std::uintptr_t>(lookup(ids[i]));
+    }
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  g_sink = sink;
+  return ids.size() * rounds / seconds / 1e6;
+}
+
+template <typename Create>
+double MeasureClones(Create create, const std::vector<int> &ids, int rounds) {
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (int r = 0; r < rounds; r++) {
+    for (std::size_t i = 0; i < ids.size(); i++) {
+      delete create(ids[i]);
+    }
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return ids.size() * rounds / seconds / 1e6;
+}
+
+void Benchmark(int rounds) {
+  HashPrototypeFactory hash_factory;
+  PrototypeFactory array_factory;
+  PrototypeRegistry registry;
+  registry.Register("PLUGIN_1", new PluginPrototype("PLUGIN_1 ", 7));
+  registry.Register("PLUGIN_2", new PluginPrototype("PLUGIN_2 ", 8));
+
+  std::vector<int> builtin_ids(4096);
+  std::vector<int> all_ids(4096);
+  std::srand(42);
+  for (std::size_t i = 0; i < builtin_ids.size(); i++) {
+    builtin_ids[i] = std::rand() % PROTOTYPE_COUNT;
+    all_ids[i] = std::rand() % static_cast<int>(registry.size());
+  }
+
+  std::cout << "Benchmark: " << builtin_ids.size() * rounds << " operations, M operations/s\n";
+  std::cout << "                          lookup\tclone\n";
+  std::cout << "unordered_map factory:    "
+            << MeasureLookups([&](int id) { return hash_factory.Find(static_cast<Type>(id)); }, builtin_ids, rounds)
+            << "\t"
+            << MeasureClones([&](int id) { return hash_factory.CreatePrototype(static_cast<Type>(id)); }, builtin_ids,
+                             rounds)
+            << "\n";
+  std::cout << "array factory:            "
+            << MeasureLookups([&](int id) { return array_factory.Find(static_cast<Type>(id)); }, builtin_ids, rounds)
+            << "\t"
+            << MeasureClones([&](int id) { return array_factory.CreatePrototype(static_cast<Type>(id)); },
+                             builtin_ids, rounds)
+            << "\n";
+  std::cout << "array, compile-time type: "
+            << "-\t"
+            << MeasureClones(
+                   [&](int id) {
+                     return id == Type::PROTOTYPE_1 ? array_factory.CreatePrototype<Type::PROTOTYPE_1>()
+                                                    : array_factory.CreatePrototype<Type::PROTOTYPE_2>();
+                   },
+                   builtin_ids, rounds)
+            << "\n";
+  std::cout << "registry with plugins:    "
+            << MeasureLookups([&](int id) { return registry.Find(id); }, all_ids, rounds) << "\t"
+            << MeasureClones([&](int id) { return registry.CreatePrototype(id); }, all_ids, rounds) << "\n";
+}
+
+int main(int argc, char *argv[]) {
+  PrototypeRegistry registry;
+  Client(registry);
+  int rounds = argc > 1 ? std::atoi(argv[1]) : 2000;
+  Benchmark(rounds);
+  return 0;
+}
@@ -0,0 +1,461 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using std::string;
+
+// Паттерн Прототип
+//
+// Назначение: Позволяет копировать объекты, не вдаваясь в подробности их
+// реализации.
+//
+// Конструктор PrototypeFactory создаёт все прототипы сразу, а настоящие
+// прототипы бывают дорогими: при создании они что-то вычисляют или
+// загружают. Этот вариант один раз сохраняет готовые прототипы в
+// компактный двоичный снимок. При следующем запуске фабрика отображает
+// снимок в память (mmap) и восстанавливает прототип только при первом
+// CreatePrototype для его типа; восстановление — это копирование байтов, а
+// не повторное вычисление.
+//
+// Пример использует POSIX (open, mmap).
+
+enum Type {
+  PROTOTYPE_1 = 0,
+  PROTOTYPE_2,
+  PROTOTYPE_COUNT
+};
+
+/**
+ * Запись и чтение полей снимка. Числа хранятся в порядке байтов машины:
+ * снимок — это кэш для той же программы на той же машине, а не формат
+ * обмена.
+ */
+class SnapshotWriter {
+ private:
+  string *out_;
+
+ public:
+  explicit SnapshotWriter(string *out) : out_(out) {
+  }
+  template <typename T>
+  void Write(const T &value) {
+    out_->append(reinterpret_cast<const char *>(&value), sizeof(T));
+  }
+  void WriteString(const string &value) {
+    Write<std::uint32_t>(static_cast<std::uint32_t>(value.size()));
+    out_->append(value);
+  }
+  template <typename T>
+  void WriteArray(const std::vector<T> &values) {
+    Write<std::uint32_t>(static_cast<std::uint32_t>(values.size()));
+    out_->append(reinterpret_cast<const char *>(values.data()), values.size() * sizeof(T));
+  }
+};
+
+class SnapshotReader {
+ private:
+  const char *data_;
+  std::size_t size_;
+
+  const char *Take(std::size_t bytes) {
+    if (bytes > size_) {
+      throw std::runtime_error("Snapshot: truncated record");
+    }
+    const char *p = data_;
+    data_ += bytes;
+    size_ -= bytes;
+    return p;
+  }
+
+ public:
+  SnapshotReader(const char *data, std::size_t size) : data_(data), size_(size) {
+  }
+  template <typename T>
+  T Read() {
+    T value;
+    std::memcpy(&value, Take(sizeof(T)), sizeof(T));
+    return value;
+  }
+  string ReadString() {
+    std::uint32_t size = Read<std::uint32_t>();
+    return string(Take(size), size);
+  }
+  template <typename T>
+  std::vector<T> ReadArray() {
+    std::uint32_t count = Read<std::uint32_t>();
+    const char *bytes = Take(count * sizeof(T));
+    std::vector<T> values(count);
+    std::memcpy(values.data(), bytes, count * sizeof(T));
+    return values;
+  }
+  /**
+   * Запись должна быть прочитана целиком: лишние байты значат, что снимок
+   * повреждён или записан другой версией программы.
+   */
+  void ExpectEnd() const {
+    if (size_ != 0) {
+      throw std::runtime_error("Snapshot: trailing bytes in record");
+    }
+  }
+};
+
+class Prototype {
+ protected:
+  string prototype_name_;
+  float prototype_field_;
+
+ public:
+  Prototype() {}
+  Prototype(string prototype_name)
+      : prototype_name_(prototype_name) {
+  }
+  virtual ~Prototype() {}
+  virtual Prototype *Clone() const = 0;
+  virtual void Method(float prototype_field) {
+    this->prototype_field_ = prototype_field;
+    std::cout << "Call Method from " << prototype_name_ << " with field : " << prototype_field << std::endl;
+  }
+  /**
+   * Сохраняет всё состояние прототипа, включая результаты дорогих
+   * вычислений конструктора.
+   */
+  virtual void Serialize(SnapshotWriter *writer) const = 0;
+};
+
+/**
+ * Таблица, которую прототип строит в конструкторе. Её построение имитирует
+ * дорогую инициализацию настоящих прототипов.
+ */
+std::vector<float> BuildTable(std::size_t size, float scale) {
+  std::vector<float> table(size);
+  for (std::size_t i = 0; i < size; i++) {
+    table[i] = scale * std::sin(i * 0.001f) * std::exp(-(i % 1000) * 0.001f);
+  }
+  return table;
+}
+
+class ConcretePrototype1 : public Prototype {
+ private:
+  float concrete_prototype_field1_;
+  std::vector<float> table_;
+
+ public:
+  ConcretePrototype1(string prototype_name, float concrete_prototype_field, std::size_t table_size)
+      : Prototype(prototype_name), concrete_prototype_field1_(concrete_prototype_field),
+        table_(BuildTable(table_size, concrete_prototype_field)) {
+  }
+  /**
+   * Восстановление из снимка: таблица уже посчитана.
+   */
+  explicit ConcretePrototype1(SnapshotReader *reader)
+      : Prototype(reader->ReadString()), concrete_prototype_field1_(reader->Read<float>()),
+        table_(reader->ReadArray<float>()) {
+  }
+  Prototype *Clone() const override {
+    return new ConcretePrototype1(*this);
+  }
+  void Serialize(SnapshotWriter *writer) const override {
+    writer->WriteString(prototype_name_);
+    writer->Write(concrete_prototype_field1_);
+    writer->WriteArray(table_);
+  }
+};
+
+class ConcretePrototype2 : public Prototype {
+ private:
+  float concrete_prototype_field2_;
+  std::vector<float> table_;
+
+ public:
+  ConcretePrototype2(string prototype_name, float concrete_prototype_field, std::size_t table_size)
+      : Prototype(prototype_name), concrete_prototype_field2_(concrete_prototype_field),
+        table_(BuildTable(table_size, concrete_prototype_field)) {
+  }
+  explicit ConcretePrototype2(SnapshotReader *reader)
+      : Prototype(reader->ReadString()), concrete_prototype_field2_(reader->Read<float>()),
+        table_(reader->ReadArray<float>()) {
+  }
+  Prototype *Clone() const override {
+    return new ConcretePrototype2(*this);
+  }
+  void Serialize(SnapshotWriter *writer) const override {
+    writer->WriteString(prototype_name_);
+    writer->Write(concrete_prototype_field2_);
+    writer->WriteArray(table_);
+  }
+};
+
+static const std::size_t kTableSize = 1 << 20;
+
+/**
+ * Фабрика из основного примера: все прототипы строятся в конструкторе.
+ */
+class PrototypeFactory {
+ private:
+  Prototype *prototypes_[PROTOTYPE_COUNT];
+
+ public:
+  PrototypeFactory() {
+    prototypes_[Type::PROTOTYPE_1] = new ConcretePrototype1("PROTOTYPE_1 ", 50.f, kTableSize);
+    prototypes_[Type::PROTOTYPE_2] = new ConcretePrototype2("PROTOTYPE_2 ", 60.f, kTableSize);
+  }
+  ~PrototypeFactory() {
+    for (int type = 0; type < PROTOTYPE_COUNT; type++) {
+      delete prototypes_[type];
+    }
+  }
+  Prototype *CreatePrototype(Type type) const {
+    return prototypes_[type]->Clone();
+  }
+  const Prototype *Find(Type type) const {
+    return prototypes_[type];
+  }
+};
+
+/**
+ * Формат снимка: заголовок, таблица записей (смещение и длина для каждого
+ * типа) и сами записи.
+ */
+static const std::uint32_t kSnapshotMagic = 0x504e5350;  // "PSNP"
+static const std::uint32_t kSnapshotVersion = 1;
+
+struct SnapshotHeader {
+  std::uint32_t magic;
+  std::uint32_t version;
+  std::uint32_t count;
+  std::uint32_t reserved;
+};
+
+struct SnapshotEntry {
+  std::uint64_t offset;
+  std::uint64_t size;
+};
+
+void WriteSnapshot(const string &path, const PrototypeFactory &factory) {
+  std::vector<string> records(PROTOTYPE_COUNT);
+  for (int type = 0; type < PROTOTYPE_COUNT; type++) {
+    SnapshotWriter writer(&records[type]);
+    factory.Find(static_cast<Type>(type))->Serialize(&writer);
+  }
+  string out;
+  SnapshotWriter writer(&out);
+  SnapshotHeader header = {kSnapshotMagic, kSnapshotVersion, PROTOTYPE_COUNT, 0};
+  writer.Write(header);
+  std::uint64_t offset = sizeof(SnapshotHeader) + PROTOTYPE_COUNT * sizeof(SnapshotEntry);
+  for (int type = 0; type < PROTOTYPE_COUNT; type++) {
+    SnapshotEntry entry = {offset, records[type].size()};
+    writer.Write(entry);
+    offset += records[type].size();
+  }
+  for (int type = 0; type < PROTOTYPE_COUNT; type++) {
+    out += records[type];
+  }
+
+  // Снимок пишется во временный файл и переименовывается только после
+  // fsync, поэтому сбой посреди записи оставляет прежний снимок целым.
+  string tmp_path = path + ".tmp";
+  int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    throw std::runtime_error("Snapshot: cannot create " + tmp_path);
+  }
+  std::size_t written = 0;
+  while (written < out.size()) {
+    ssize_t n = ::write(fd, out.data() + written, out.size() - written);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    written += static_cast<std::size_t>(n);
+  }
+  bool ok = written == out.size() && ::fsync(fd) == 0;
+  ok = ::close(fd) == 0 && ok;
+  if (!ok || ::rename(tmp_path.c_str(), path.c_str()) != 0) {
+    ::unlink(tmp_path.c_str());
+    throw std::runtime_error("Snapshot: cannot write " + path);
+  }
+}
+
+/**
+ * Фабрика, читающая прототипы из снимка. Конструктор только отображает файл
+ * и проверяет заголовок; прототип типа восстанавливается при первом
+ * CreatePrototype этого типа. CreatePrototype можно вызывать из нескольких
+ * потоков: восстановлением каждого типа управляет свой once_flag.
+ */
+class SnapshotPrototypeFactory {
+ private:
+  int fd_;
+  const char *data_;
+  std::size_t size_;
+  const SnapshotEntry *entries_;
+  Prototype *prototypes_[PROTOTYPE_COUNT];
+  std::once_flag loaded_[PROTOTYPE_COUNT];
+  std::atomic<int> loaded_count_;
+
+  void Fail(const string &message) {
+    if (data_ != nullptr) {
+      ::munmap(const_cast<char *>(data_), size_);
+    }
+    if (fd_ >= 0) {
+      ::close(fd_);
+    }
+    throw std::runtime_error("Snapshot: " + message);
+  }
+
+  Prototype *Load(Type type) {
+    SnapshotReader reader(data_ + entries_[type].offset, entries_[type].size);
+    std::unique_ptr<Prototype> prototype;
+    switch (type) {
+      case PROTOTYPE_1:
+        prototype.reset(new ConcretePrototype1(&reader));
+        break;
+      case PROTOTYPE_2:
+        prototype.reset(new ConcretePrototype2(&reader));
+        break;
+      default:
+        throw std::runtime_error("Snapshot: unknown prototype type");
+    }
+    reader.ExpectEnd();
+    return prototype.release();
+  }
+
+ public:
+  explicit SnapshotPrototypeFactory(const string &path)
+      : fd_(-1), data_(nullptr), size_(0), entries_(nullptr), loaded_count_(0) {
+    for (int type = 0; type < PROTOTYPE_COUNT; type++) {
+      prototypes_[type] = nullptr;
+    }
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    if (fd_ < 0) {
+      Fail("cannot open " + path);
+    }
+    struct stat st;
+    if (::fstat(fd_, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(SnapshotHeader)) {
+      Fail("too short " + path);
+    }
+    size_ = static_cast<std::size_t>(st.st_size);
+    void *data = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+    if (data == MAP_FAILED) {
+      Fail("cannot map " + path);
+    }
+    data_ = static_cast<const char *>(data);
+    SnapshotHeader header;
+    std::memcpy(&header, data_, sizeof(header));
+    if (header.magic != kSnapshotMagic || header.version != kSnapshotVersion || header.count != PROTOTYPE_COUNT ||
+        size_ < sizeof(SnapshotHeader) + PROTOTYPE_COUNT * sizeof(SnapshotEntry)) {
+      Fail("incompatible snapshot " + path);
+    }
+    entries_ = reinterpret_cast<const SnapshotEntry *>(data_ + sizeof(SnapshotHeader));
+    for (int type = 0; type < PROTOTYPE_COUNT; type++) {
+      if (entries_[type].offset > size_ || entries_[type].size > size_ - entries_[type].offset) {
+        Fail("corrupt entry table in " + path);
+      }
+    }
+  }
+
+  ~SnapshotPrototypeFactory() {
+    for (int type = 0; type < PROTOTYPE_COUNT; type++) {
+      delete prototypes_[type];
+    }
+    ::munmap(const_cast<char *>(data_), size_);
+    ::close(fd_);
+  }
+
+  SnapshotPrototypeFactory(const SnapshotPrototypeFactory &) = delete;
+  SnapshotPrototypeFactory &operator=(const SnapshotPrototypeFactory &) = delete;
+
+  Prototype *CreatePrototype(Type type) {
+    std::call_once(loaded_[type], [this, type] {
+      prototypes_[type] = Load(type);
+      loaded_count_.fetch_add(1);
+    });
+    return prototypes_[type]->Clone();
+  }
+
+  /**
+   * Можно вызывать одновременно с CreatePrototype: prototypes_ здесь не
+   * читается.
+   */
+  int loaded_count() const {
+    return loaded_count_.load();
+  }
+};
+
+void Client(SnapshotPrototypeFactory &prototype_factory) {
+  std::cout << "Let's create a Prototype 1\n";
+  Prototype *prototype = prototype_factory.CreatePrototype(Type::PROTOTYPE_1);
+  prototype->Method(90);
+  delete prototype;
+  std::cout << "Prototypes restored from the snapshot so far: " << prototype_factory.loaded_count() << "\n\n";
+
+  std::cout << "Let's create a Prototype 2 \n";
+  prototype = prototype_factory.CreatePrototype(Type::PROTOTYPE_2);
+  prototype->Method(10);
+  delete prototype;
+  std::cout << "Prototypes restored from the snapshot so far: " << prototype_factory.loaded_count() << "\n\n";
+}
+
+double MsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main() {
+  const string path = "prototypes.snapshot";
+  typedef std::chrono::steady_clock Clock;
+
+  // Первый запуск: строим прототипы конструкторами и сохраняем снимок.
+  Clock::time_point start = Clock::now();
+  PrototypeFactory *prototype_factory = new PrototypeFactory();
+  double eager_ms = MsSince(start);
+  Prototype *clone = prototype_factory->CreatePrototype(Type::PROTOTYPE_1);
+  double eager_first_clone_ms = MsSince(start);
+  delete clone;
+  start = Clock::now();
+  WriteSnapshot(path, *prototype_factory);
+  double write_ms = MsSince(start);
+  delete prototype_factory;
+
+  {
+    SnapshotPrototypeFactory snapshot_factory(path);
+    Client(snapshot_factory);
+  }
+
+  // Следующие запуски: только снимок.
+  start = Clock::now();
+  SnapshotPrototypeFactory *snapshot_factory = new SnapshotPrototypeFactory(path);
+  double open_ms = MsSince(start);
+  clone = snapshot_factory->CreatePrototype(Type::PROTOTYPE_1);
+  double snapshot_first_clone_ms = MsSince(start);
+  delete clone;
+  start = Clock::now();
+  clone = snapshot_factory->CreatePrototype(Type::PROTOTYPE_2);
+  double second_type_ms = MsSince(start);
+  delete clone;
+  delete snapshot_factory;
+  std::remove(path.c_str());
+
+  std::cout << "Benchmark: " << PROTOTYPE_COUNT << " prototypes with " << kTableSize << "-entry tables\n";
+  std::cout << "Constructors: factory ready " << eager_ms << " ms, first PROTOTYPE_1 clone at "
+            << eager_first_clone_ms << " ms\n";
+  std::cout << "Writing the snapshot: " << write_ms << " ms\n";
+  std::cout << "Snapshot: factory ready " << open_ms << " ms, first PROTOTYPE_1 clone at " << snapshot_first_clone_ms
+            << " ms, PROTOTYPE_2 restored on demand in " << second_type_ms << " ms\n";
+  return 0;
+}
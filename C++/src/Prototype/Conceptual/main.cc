@@ -1,6 +1,6 @@
 #include <iostream>
+#include <stdexcept>
 #include <string>
-#include <unordered_map>
 
 using std::string;
 
@@ -11,7 +11,8 @@ using std::string;
 
 enum Type {
   PROTOTYPE_1 = 0,
-  PROTOTYPE_2
+  PROTOTYPE_2,
+  PROTOTYPE_COUNT
 };
 
 /**
@@ -82,11 +83,15 @@ class ConcretePrototype2 : public Prototype {
  * In PrototypeFactory you have two concrete prototypes, one for each concrete
  * prototype class, so each time you want to create a bullet , you can use the
  * existing ones and clone those.
+ *
+ * Type — плотное перечисление, поэтому прототипы хранятся в обычном массиве,
+ * индексом которого служит сам тип. Поиск прототипа — одно обращение к
+ * массиву, без хеширования и вставок.
  */
 
 class PrototypeFactory {
  private:
-  std::unordered_map<Type, Prototype *, std::hash<int>> prototypes_;
+  Prototype *prototypes_[PROTOTYPE_COUNT];
 
  public:
   PrototypeFactory() {
@@ -100,15 +105,33 @@ class PrototypeFactory {
    */
 
   ~PrototypeFactory() {
-    delete prototypes_[Type::PROTOTYPE_1];
-    delete prototypes_[Type::PROTOTYPE_2];
+    for (int type = 0; type < PROTOTYPE_COUNT; type++) {
+      delete prototypes_[type];
+    }
   }
 
   /**
    * Notice here that you just need to specify the type of the prototype you
    * want and the method will create from the object with this type.
    */
-  Prototype *CreatePrototype(Type type) {
+  /**
+   * Тип известен только при выполнении, поэтому он проверяется здесь: для
+   * значения вне перечисления бросается std::out_of_range.
+   */
+  Prototype *CreatePrototype(Type type) const {
+    if (type < 0 || type >= PROTOTYPE_COUNT) {
+      throw std::out_of_range("PrototypeFactory: unknown prototype type " + std::to_string(type));
+    }
+    return prototypes_[type]->Clone();
+  }
+
+  /**
+   * Тот же вызов для типа, известного при компиляции. Выход за пределы
+   * перечисления обнаружит компилятор.
+   */
+  template <Type type>
+  Prototype *CreatePrototype() const {
+    static_assert(type >= 0 && type < PROTOTYPE_COUNT, "unknown prototype type");
     return prototypes_[type]->Clone();
   }
 };
@@ -124,7 +147,7 @@ void Client(PrototypeFactory &prototype_factory) {
 
   std::cout << "Let's create a Prototype 2 \n";
 
-  prototype = prototype_factory.CreatePrototype(Type::PROTOTYPE_2);
+  prototype = prototype_factory.CreatePrototype<Type::PROTOTYPE_2>();
   prototype->Method(10);
 
   delete prototype;
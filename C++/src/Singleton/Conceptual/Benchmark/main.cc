@@ -0,0 +1,317 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * Паттерн Одиночка
+ *
+ * Назначение: Гарантирует, что у класса есть только один экземпляр, и
+ * предоставляет к нему глобальную точку доступа.
+ *
+ * Этот пример измеряет цену вызова GetInstance, когда экземпляр уже создан,
+ * для разных реализаций Одиночки и от 1 до 64 потоков:
+ *
+ * - NonThreadSafe: обычный указатель, как в примере NonThreadSafe. Чтобы
+ *   замер был корректным, экземпляр создаётся до запуска потоков;
+ * - Mutex: блокировка мьютекса при каждом вызове;
+ * - Atomic: блокировка с двойной проверкой на атомарном указателе, как в
+ *   примере ThreadSafe;
+ * - CallOnce: std::call_once;
+ * - Static: локальная статическая переменная (Одиночка Майерса).
+ *
+ * Отдельно измеряется, сколько раз за вызов GetInstance(value)->value()
+ * выделяется память: в старом варианте (аргумент и результат — std::string)
+ * и в новом (аргументы передаются конструктору как есть, value()
+ * возвращает ссылку).
+ */
+
+/**
+ * Счётчик выделений памяти во всех потоках. operator new и operator delete
+ * не встраиваются: иначе GCC видит free для указателя от malloc и
+ * предупреждает о несовпадении.
+ */
+static std::atomic<std::size_t> g_allocations(0);
+
+__attribute__((noinline)) void *operator new(std::size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    void *p = std::malloc(size == 0 ? 1 : size);
+    if (p == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+class NonThreadSafeSingleton
+{
+private:
+    static NonThreadSafeSingleton *singleton_;
+    NonThreadSafeSingleton() {}
+
+public:
+    static NonThreadSafeSingleton *GetInstance()
+    {
+        if (singleton_ == nullptr)
+        {
+            singleton_ = new NonThreadSafeSingleton();
+        }
+        return singleton_;
+    }
+};
+
+NonThreadSafeSingleton *NonThreadSafeSingleton::singleton_ = nullptr;
+
+class MutexSingleton
+{
+private:
+    static MutexSingleton *pinstance_;
+    static std::mutex mutex_;
+    MutexSingleton() {}
+
+public:
+    static MutexSingleton *GetInstance()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (pinstance_ == nullptr)
+        {
+            pinstance_ = new MutexSingleton();
+        }
+        return pinstance_;
+    }
+};
+
+MutexSingleton *MutexSingleton::pinstance_ = nullptr;
+std::mutex MutexSingleton::mutex_;
+
+class AtomicSingleton
+{
+private:
+    static std::atomic<AtomicSingleton *> pinstance_;
+    static std::mutex mutex_;
+    AtomicSingleton() {}
+
+public:
+    static AtomicSingleton *GetInstance()
+    {
+        AtomicSingleton *instance = pinstance_.load(std::memory_order_acquire);
+        if (instance == nullptr)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            instance = pinstance_.load(std::memory_order_relaxed);
+            if (instance == nullptr)
+            {
+                instance = new AtomicSingleton();
+                pinstance_.store(instance, std::memory_order_release);
+            }
+        }
+        return instance;
+    }
+};
+
+std::atomic<AtomicSingleton *> AtomicSingleton::pinstance_{nullptr};
+std::mutex AtomicSingleton::mutex_;
+
+class CallOnceSingleton
+{
+private:
+    static CallOnceSingleton *pinstance_;
+    static std::once_flag once_;
+    CallOnceSingleton() {}
+
+public:
+    static CallOnceSingleton *GetInstance()
+    {
+        std::call_once(once_, [] { pinstance_ = new CallOnceSingleton(); });
+        return pinstance_;
+    }
+};
+
+CallOnceSingleton *CallOnceSingleton::pinstance_ = nullptr;
+std::once_flag CallOnceSingleton::once_;
+
+class StaticSingleton
+{
+private:
+    StaticSingleton() {}
+
+public:
+    static StaticSingleton *GetInstance()
+    {
+        static StaticSingleton instance;
+        return &instance;
+    }
+};
+
+/**
+ * Прежний интерфейс примеров: строка-аргумент и копия значения при каждом
+ * вызове.
+ */
+class CopyingSingleton
+{
+private:
+    static CopyingSingleton *singleton_;
+    std::string value_;
+    CopyingSingleton(const std::string value): value_(value) {}
+
+public:
+    static CopyingSingleton *GetInstance(const std::string &value)
+    {
+        if (singleton_ == nullptr)
+        {
+            singleton_ = new CopyingSingleton(value);
+        }
+        return singleton_;
+    }
+
+    std::string value() const
+    {
+        return value_;
+    }
+};
+
+CopyingSingleton *CopyingSingleton::singleton_ = nullptr;
+
+/**
+ * Нынешний интерфейс примеров NonThreadSafe и ThreadSafe.
+ */
+class ForwardingSingleton
+{
+private:
+    static ForwardingSingleton *singleton_;
+    std::string value_;
+    ForwardingSingleton(const std::string value): value_(value) {}
+
+public:
+    template <typename... Args>
+    static ForwardingSingleton *GetInstance(Args &&... args)
+    {
+        if (singleton_ == nullptr)
+        {
+            singleton_ = new ForwardingSingleton(std::forward<Args>(args)...);
+        }
+        return singleton_;
+    }
+
+    const std::string &value() const
+    {
+        return value_;
+    }
+};
+
+ForwardingSingleton *ForwardingSingleton::singleton_ = nullptr;
+
+/**
+ * Значение длиннее буфера короткой строки (15 символов в libstdc++), иначе
+ * std::string не обращалась бы к куче и в старом варианте.
+ */
+static const char kValue[] = "primary-database.config.internal";
+
+template <typename S>
+void MeasureAllocations(const char *name, std::size_t calls)
+{
+    std::size_t length = 0;
+    std::size_t allocations = g_allocations.load();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < calls; i++)
+    {
+        length += S::GetInstance(kValue)->value().size();
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    allocations = g_allocations.load() - allocations;
+    std::cout << name << static_cast<double>(allocations) / calls << " allocations/call, " << ns / calls
+              << " ns/call (length " << length / calls << ")\n";
+}
+
+/**
+ * Каждый поток вызывает GetInstance calls раз. Барьер в цикле не даёт
+ * компилятору вынести вызов из цикла, как он сделал бы с обычным чтением
+ * статического указателя. Возвращает наносекунды на вызов с учётом того,
+ * что одновременно работают не больше hardware_threads потоков.
+ */
+template <typename S>
+double Measure(unsigned threads, std::size_t calls, unsigned hardware_threads)
+{
+    std::atomic<unsigned> ready(0);
+    std::atomic<bool> go(false);
+    std::atomic<std::uintptr_t> sink(0);
+    auto worker = [&]
+    {
+        ready.fetch_add(1);
+        while (!go.load(std::memory_order_acquire))
+        {
+            std::this_thread::yield();
+        }
+        std::uintptr_t acc = 0;
+        for (std::size_t i = 0; i < calls; i++)
+        {
+            acc ^= reinterpret_cast<std::uintptr_t>(S::GetInstance());
+            __asm__ __volatile__("" : : : "memory");
+        }
+        sink.fetch_xor(acc);
+    };
+    std::vector<std::thread> pool;
+    for (unsigned t = 0; t < threads; t++)
+    {
+        pool.push_back(std::thread(worker));
+    }
+    while (ready.load() != threads)
+    {
+        std::this_thread::yield();
+    }
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for (std::size_t t = 0; t < pool.size(); t++)
+    {
+        pool[t].join();
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    return ns * std::min(threads, hardware_threads) / (static_cast<double>(calls) * threads);
+}
+
+int main(int argc, char *argv[])
+{
+    std::size_t calls = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+    unsigned hardware_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    // Небезопасный вариант создаём заранее: гонка при создании — не то, что
+    // здесь измеряется.
+    NonThreadSafeSingleton::GetInstance();
+
+    MeasureAllocations<CopyingSingleton>("GetInstance(std::string)->value() by copy: ", calls);
+    MeasureAllocations<ForwardingSingleton>("GetInstance(args...)->value() by ref:     ", calls);
+    std::cout << "\n";
+
+    std::cout << "ns per GetInstance call, " << calls << " calls per thread, " << hardware_threads
+              << " hardware threads\n";
+    std::cout << "threads  NonThreadSafe  Mutex  Atomic  CallOnce  Static\n";
+    for (unsigned threads = 1; threads <= 64; threads *= 2)
+    {
+        std::cout << threads << "\t " << Measure<NonThreadSafeSingleton>(threads, calls, hardware_threads)
+                  << "\t" << Measure<MutexSingleton>(threads, calls, hardware_threads)
+                  << "\t" << Measure<AtomicSingleton>(threads, calls, hardware_threads)
+                  << "\t" << Measure<CallOnceSingleton>(threads, calls, hardware_threads)
+                  << "\t" << Measure<StaticSingleton>(threads, calls, hardware_threads) << "\n";
+    }
+    return 0;
+}
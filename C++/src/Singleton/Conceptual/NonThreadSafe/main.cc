@@ -1,6 +1,7 @@
 #include <iostream>
 #include <string>
 #include <thread>
+#include <utility>
 
 /**
  * Паттерн Одиночка
@@ -45,9 +46,14 @@ public:
      * первом запуске, он создаёт экземпляр одиночки и помещает его в
      * статическое поле. При последующих запусках, он возвращает клиенту объект,
      * хранящийся в статическом поле.
+     *
+     * Аргументы передаются конструктору как есть и нужны только при первом
+     * вызове. Если передать строковый литерал, временная std::string не
+     * создаётся, поэтому повторные вызовы ничего не выделяют в куче.
      */
 
-    static Singleton *GetInstance(const std::string& value);
+    template <typename... Args>
+    static Singleton *GetInstance(Args&&... args);
     /**
      * Наконец, любой одиночка должен содержать некоторую бизнес-логику, которая
      * может быть выполнена на его экземпляре.
@@ -57,7 +63,10 @@ public:
         // ...
     }
 
-    std::string value() const{
+    /**
+     * Возвращает ссылку, а не копию: чтение значения не выделяет память.
+     */
+    const std::string& value() const{
         return value_;
     } 
 };
@@ -67,14 +76,15 @@ Singleton* Singleton::singleton_= nullptr;;
 /**
  * Static methods should be defined outside the class.
  */
-Singleton *Singleton::GetInstance(const std::string& value)
+template <typename... Args>
+Singleton *Singleton::GetInstance(Args&&... args)
 {
     /**
      * This is a safer way to create an instance. instance = new Singleton is
      * dangeruous in case two instance threads wants to access at the same time
      */
     if(singleton_==nullptr){
-        singleton_ = new Singleton(value);
+        singleton_ = new Singleton(std::forward<Args>(args)...);
     }
     return singleton_;
 }
@@ -0,0 +1,356 @@
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Паттерн Одиночка
+ *
+ * Назначение: Гарантирует, что у класса есть только один экземпляр, и
+ * предоставляет к нему глобальную точку доступа.
+ *
+ * Этот вариант собирает одиночек процесса в реестр. Каждый одиночка
+ * объявляет, от кого он зависит. Реестр создаёт его не раньше зависимостей:
+ * либо лениво, при первом Get, либо заранее, при старте, через InitAll. В
+ * этом случае независимые одиночки создаются параллельно, и время старта
+ * равно самой длинной цепочке зависимостей, а не сумме всех инициализаций.
+ * Для каждого одиночки реестр запоминает время инициализации.
+ */
+
+/**
+ * Базовый класс одиночек, которыми управляет реестр.
+ */
+class Service
+{
+public:
+    virtual ~Service() {}
+};
+
+class SingletonRegistry
+{
+public:
+    typedef std::function<Service *()> Factory;
+    typedef std::chrono::steady_clock Clock;
+
+private:
+    enum VisitState
+    {
+        NOT_VISITED = 0,
+        IN_PROGRESS,
+        VISITED
+    };
+
+    struct Entry
+    {
+        std::string name;
+        std::vector<std::string> dependencies;
+        Factory factory;
+        std::once_flag once;
+        std::unique_ptr<Service> instance;
+        Clock::time_point started;
+        Clock::duration init_time;
+        std::thread::id thread;
+    };
+
+    std::map<std::string, std::unique_ptr<Entry>> entries_;
+    std::mutex registration_mutex_;
+    bool frozen_;
+    std::once_flag checked_;
+    Clock::time_point epoch_;
+
+    Entry *Find(const std::string &name)
+    {
+        std::map<std::string, std::unique_ptr<Entry>>::iterator it = entries_.find(name);
+        if (it == entries_.end())
+        {
+            throw std::logic_error("SingletonRegistry: unknown singleton " + name);
+        }
+        return it->second.get();
+    }
+
+    /**
+     * Поиск в глубину. Встретив одиночку, который ещё в обработке, мы нашли
+     * цикл: такие одиночки ждали бы друг друга вечно.
+     */
+    void Visit(Entry *entry, std::map<Entry *, VisitState> *states, std::vector<std::string> *path)
+    {
+        VisitState &state = (*states)[entry];
+        if (state == VISITED)
+        {
+            return;
+        }
+        path->push_back(entry->name);
+        if (state == IN_PROGRESS)
+        {
+            std::string cycle;
+            std::size_t first = std::find(path->begin(), path->end(), entry->name) - path->begin();
+            for (std::size_t i = first; i < path->size(); i++)
+            {
+                cycle += (cycle.empty() ? "" : " -> ") + (*path)[i];
+            }
+            throw std::logic_error("SingletonRegistry: dependency cycle " + cycle);
+        }
+        state = IN_PROGRESS;
+        for (std::size_t i = 0; i < entry->dependencies.size(); i++)
+        {
+            Visit(Find(entry->dependencies[i]), states, path);
+        }
+        (*states)[entry] = VISITED;
+        path->pop_back();
+    }
+
+    /**
+     * Проверяет граф один раз, перед первой инициализацией. После этого
+     * регистрировать новых одиночек нельзя: реестр замораживается под тем же
+     * мьютексом, что и Register, и дальше entries_ только читается, поэтому
+     * Get обходится без блокировок.
+     */
+    void CheckGraph()
+    {
+        std::call_once(checked_, [this] {
+            std::lock_guard<std::mutex> lock(registration_mutex_);
+            frozen_ = true;
+            std::map<Entry *, VisitState> states;
+            for (auto it = entries_.begin(); it != entries_.end(); ++it)
+            {
+                std::vector<std::string> path;
+                Visit(it->second.get(), &states, &path);
+            }
+        });
+    }
+
+    static void JoinAll(std::vector<std::thread> *threads)
+    {
+        for (std::size_t i = 0; i < threads->size(); i++)
+        {
+            (*threads)[i].join();
+        }
+    }
+
+    Service *GetEntry(Entry *entry)
+    {
+        std::call_once(entry->once, [this, entry] {
+            for (std::size_t i = 0; i < entry->dependencies.size(); i++)
+            {
+                GetEntry(Find(entry->dependencies[i]));
+            }
+            entry->started = Clock::now();
+            entry->instance.reset(entry->factory());
+            entry->init_time = Clock::now() - entry->started;
+            entry->thread = std::this_thread::get_id();
+        });
+        return entry->instance.get();
+    }
+
+public:
+    SingletonRegistry() : frozen_(false), epoch_(Clock::now()) {}
+
+    SingletonRegistry(SingletonRegistry &other) = delete;
+    void operator=(const SingletonRegistry &) = delete;
+
+    /**
+     * Реестр всего процесса. Отдельные экземпляры реестра нужны только
+     * примеру, чтобы сравнить ленивый и параллельный старт.
+     */
+    static SingletonRegistry *GetInstance()
+    {
+        static SingletonRegistry instance;
+        return &instance;
+    }
+
+    /**
+     * Бросает std::logic_error, если инициализация уже началась.
+     */
+    void Register(const std::string &name, const std::vector<std::string> &dependencies, Factory factory)
+    {
+        std::lock_guard<std::mutex> lock(registration_mutex_);
+        if (frozen_)
+        {
+            throw std::logic_error("SingletonRegistry: cannot register " + name + " after initialization started");
+        }
+        std::unique_ptr<Entry> entry(new Entry());
+        entry->name = name;
+        entry->dependencies = dependencies;
+        entry->factory = factory;
+        entry->init_time = Clock::duration::zero();
+        entries_[name] = std::move(entry);
+    }
+
+    /**
+     * Возвращает одиночку, при необходимости создав сначала его зависимости,
+     * а затем его самого. Потокобезопасен: если одиночку уже создаёт другой
+     * поток, вызов дождётся окончания.
+     */
+    template <typename T>
+    T *Get(const std::string &name)
+    {
+        CheckGraph();
+        return static_cast<T *>(GetEntry(Find(name)));
+    }
+
+    /**
+     * Создаёт всех одиночек заранее. Для каждого запускается свой поток;
+     * поток первым делом ждёт зависимости, так что независимые одиночки
+     * создаются одновременно, а зависимые — сразу, как только готовы их
+     * зависимости. Если фабрика бросила исключение, InitAll дожидается всех
+     * потоков и бросает первое из исключений.
+     */
+    void InitAll()
+    {
+        CheckGraph();
+        std::vector<std::thread> threads;
+        std::vector<std::exception_ptr> errors(entries_.size());
+        threads.reserve(entries_.size());
+        try
+        {
+            std::size_t i = 0;
+            for (std::map<std::string, std::unique_ptr<Entry>>::iterator it = entries_.begin(); it != entries_.end();
+                 ++it, ++i)
+            {
+                Entry *entry = it->second.get();
+                std::exception_ptr *error = &errors[i];
+                threads.push_back(std::thread([this, entry, error] {
+                    try
+                    {
+                        GetEntry(entry);
+                    }
+                    catch (...)
+                    {
+                        *error = std::current_exception();
+                    }
+                }));
+            }
+        }
+        catch (...)
+        {
+            JoinAll(&threads);
+            throw;
+        }
+        JoinAll(&threads);
+        for (std::size_t i = 0; i < errors.size(); i++)
+        {
+            if (errors[i])
+            {
+                std::rethrow_exception(errors[i]);
+            }
+        }
+    }
+
+    /**
+     * Печатает созданных одиночек в порядке начала инициализации: когда она
+     * началась (от создания реестра) и сколько длилась.
+     */
+    void PrintReport()
+    {
+        std::vector<Entry *> created;
+        Clock::duration total = Clock::duration::zero();
+        for (std::map<std::string, std::unique_ptr<Entry>>::iterator it = entries_.begin(); it != entries_.end(); ++it)
+        {
+            if (it->second->instance)
+            {
+                created.push_back(it->second.get());
+                total += it->second->init_time;
+            }
+        }
+        std::sort(created.begin(), created.end(),
+                  [](const Entry *a, const Entry *b) { return a->started < b->started; });
+        std::map<std::thread::id, int> thread_numbers;
+        for (std::size_t i = 0; i < created.size(); i++)
+        {
+            const Entry *entry = created[i];
+            thread_numbers.insert(std::make_pair(entry->thread, static_cast<int>(thread_numbers.size()) + 1));
+            std::cout << "  " << std::left << std::setw(10) << entry->name << std::right
+                      << " start " << std::setw(4) << Ms(entry->started - epoch_) << " ms"
+                      << "  init " << std::setw(4) << Ms(entry->init_time) << " ms"
+                      << "  thread #" << thread_numbers[entry->thread] << "\n";
+        }
+        std::cout << "  sum of init times " << Ms(total) << " ms\n";
+    }
+
+    static long long Ms(Clock::duration duration)
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
+    }
+};
+
+/**
+ * Одиночка-пример: его конструктор имитирует медленную инициализацию
+ * (чтение конфигурации, подключение к базе и т. п.).
+ */
+class SlowService : public Service
+{
+public:
+    explicit SlowService(int init_ms)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(init_ms));
+    }
+};
+
+void RegisterServices(SingletonRegistry *registry)
+{
+    struct Spec
+    {
+        const char *name;
+        std::vector<std::string> dependencies;
+        int init_ms;
+    };
+    const Spec specs[] = {
+        {"config", {}, 20},
+        {"metrics", {}, 50},
+        {"logger", {"config"}, 30},
+        {"database", {"config"}, 80},
+        {"cache", {"config", "metrics"}, 40},
+        {"api", {"logger", "database", "cache"}, 10},
+    };
+    for (const Spec &spec : specs)
+    {
+        int init_ms = spec.init_ms;
+        registry->Register(spec.name, spec.dependencies, [init_ms] { return new SlowService(init_ms); });
+    }
+}
+
+int main()
+{
+    {
+        SingletonRegistry registry;
+        RegisterServices(&registry);
+        SingletonRegistry::Clock::time_point start = SingletonRegistry::Clock::now();
+        registry.Get<SlowService>("api");
+        std::cout << "Lazy: first Get(\"api\") took "
+                  << SingletonRegistry::Ms(SingletonRegistry::Clock::now() - start) << " ms\n";
+        registry.PrintReport();
+    }
+    {
+        SingletonRegistry registry;
+        RegisterServices(&registry);
+        SingletonRegistry::Clock::time_point start = SingletonRegistry::Clock::now();
+        registry.InitAll();
+        std::cout << "\nParallel: InitAll took " << SingletonRegistry::Ms(SingletonRegistry::Clock::now() - start)
+                  << " ms (longest chain config -> database -> api is 110 ms)\n";
+        registry.PrintReport();
+    }
+    {
+        SingletonRegistry *registry = SingletonRegistry::GetInstance();
+        registry->Register("a", {"b"}, [] { return new SlowService(0); });
+        registry->Register("b", {"c"}, [] { return new SlowService(0); });
+        registry->Register("c", {"a"}, [] { return new SlowService(0); });
+        try
+        {
+            registry->Get<SlowService>("a");
+        }
+        catch (const std::logic_error &e)
+        {
+            std::cout << "\n" << e.what() << "\n";
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,214 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Паттерн Одиночка
+ *
+ * Назначение: Гарантирует, что у класса есть только один экземпляр, и
+ * предоставляет к нему глобальную точку доступа.
+ *
+ * Все потоки, вызывающие SomeBusinessLogic, работают с одним экземпляром.
+ * Если одиночка при этом что-то считает, его счётчики лежат в одной строке
+ * кэша, и ядра процессора постоянно отбирают её друг у друга. Этот вариант
+ * делит изменяемое состояние одиночки на сегменты (shards): каждый поток
+ * пишет в свой сегмент, занимающий отдельную строку кэша, а чтение
+ * складывает все сегменты.
+ */
+
+static const std::size_t kCacheLineSize = 64;
+
+/**
+ * Сводная статистика, которую одиночка отдаёт при чтении.
+ */
+struct Stats
+{
+    std::uint64_t requests;
+    std::uint64_t bytes;
+    std::uint64_t max_request;
+};
+
+/**
+ * Одиночка с общим состоянием под мьютексом, для сравнения.
+ */
+class MutexSingleton
+{
+private:
+    std::mutex mutex_;
+    Stats stats_;
+
+    MutexSingleton()
+    {
+        stats_.requests = 0;
+        stats_.bytes = 0;
+        stats_.max_request = 0;
+    }
+
+public:
+    MutexSingleton(MutexSingleton &other) = delete;
+    void operator=(const MutexSingleton &) = delete;
+
+    static MutexSingleton *GetInstance()
+    {
+        static MutexSingleton instance;
+        return &instance;
+    }
+
+    void SomeBusinessLogic(std::uint64_t request_bytes)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.requests++;
+        stats_.bytes += request_bytes;
+        stats_.max_request = std::max(stats_.max_request, request_bytes);
+    }
+
+    Stats stats()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+};
+
+/**
+ * Одиночка с сегментированным состоянием. Поток получает номер сегмента при
+ * первом обращении. Если потоков больше, чем сегментов, несколько потоков
+ * делят сегмент, поэтому поля сегмента атомарные; пока поток один в
+ * сегменте, relaxed-операции над ними почти так же дёшевы, как обычные.
+ */
+class ShardedSingleton
+{
+public:
+    static const std::size_t kShardCount = 64;
+
+private:
+    struct alignas(kCacheLineSize) Shard
+    {
+        std::atomic<std::uint64_t> requests;
+        std::atomic<std::uint64_t> bytes;
+        std::atomic<std::uint64_t> max_request;
+    };
+
+    Shard shards_[kShardCount];
+    std::atomic<std::size_t> next_shard_;
+
+    ShardedSingleton() : next_shard_(0)
+    {
+        for (std::size_t i = 0; i < kShardCount; i++)
+        {
+            shards_[i].requests.store(0, std::memory_order_relaxed);
+            shards_[i].bytes.store(0, std::memory_order_relaxed);
+            shards_[i].max_request.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    Shard &LocalShard()
+    {
+        static thread_local std::size_t index = next_shard_.fetch_add(1, std::memory_order_relaxed) % kShardCount;
+        return shards_[index];
+    }
+
+public:
+    ShardedSingleton(ShardedSingleton &other) = delete;
+    void operator=(const ShardedSingleton &) = delete;
+
+    static ShardedSingleton *GetInstance()
+    {
+        static ShardedSingleton instance;
+        return &instance;
+    }
+
+    void SomeBusinessLogic(std::uint64_t request_bytes)
+    {
+        Shard &shard = LocalShard();
+        shard.requests.fetch_add(1, std::memory_order_relaxed);
+        shard.bytes.fetch_add(request_bytes, std::memory_order_relaxed);
+        std::uint64_t max = shard.max_request.load(std::memory_order_relaxed);
+        while (request_bytes > max &&
+               !shard.max_request.compare_exchange_weak(max, request_bytes, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    /**
+     * Складывает сегменты. Снимок не атомарен относительно писателей: поля
+     * разных сегментов читаются в разные моменты, но каждое значение когда-то
+     * действительно было.
+     */
+    Stats stats()
+    {
+        Stats total = {0, 0, 0};
+        for (std::size_t i = 0; i < kShardCount; i++)
+        {
+            total.requests += shards_[i].requests.load(std::memory_order_relaxed);
+            total.bytes += shards_[i].bytes.load(std::memory_order_relaxed);
+            total.max_request = std::max(total.max_request, shards_[i].max_request.load(std::memory_order_relaxed));
+        }
+        return total;
+    }
+};
+
+static_assert(sizeof(ShardedSingleton) >= ShardedSingleton::kShardCount * kCacheLineSize,
+              "each shard must occupy its own cache line");
+
+/**
+ * threads потоков вызывают SomeBusinessLogic по calls раз. Возвращает
+ * миллионы вызовов в секунду.
+ */
+template <typename S>
+double Measure(unsigned threads, std::size_t calls)
+{
+    std::atomic<bool> go(false);
+    std::vector<std::thread> pool;
+    for (unsigned t = 0; t < threads; t++)
+    {
+        pool.push_back(std::thread([&go, calls, t] {
+            while (!go.load(std::memory_order_acquire))
+            {
+                std::this_thread::yield();
+            }
+            S *singleton = S::GetInstance();
+            for (std::size_t i = 0; i < calls; i++)
+            {
+                singleton->SomeBusinessLogic((i + t) % 1500);
+            }
+        }));
+    }
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for (std::size_t t = 0; t < pool.size(); t++)
+    {
+        pool[t].join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return calls * threads / seconds / 1e6;
+}
+
+int main(int argc, char *argv[])
+{
+    std::size_t calls = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000000;
+    unsigned hardware_threads = std::max(1u, std::thread::hardware_concurrency());
+    std::cout << "M calls/s, " << calls << " calls per thread, " << hardware_threads << " hardware threads\n";
+    std::cout << "threads  Mutex  Sharded\n";
+    for (unsigned threads = 1; threads <= std::max(8u, hardware_threads); threads *= 2)
+    {
+        std::cout << threads << "\t " << Measure<MutexSingleton>(threads, calls) << "\t"
+                  << Measure<ShardedSingleton>(threads, calls) << "\n";
+    }
+
+    Stats mutex = MutexSingleton::GetInstance()->stats();
+    Stats sharded = ShardedSingleton::GetInstance()->stats();
+    std::cout << "\nMutex:   requests=" << mutex.requests << " bytes=" << mutex.bytes
+              << " max=" << mutex.max_request << "\n";
+    std::cout << "Sharded: requests=" << sharded.requests << " bytes=" << sharded.bytes
+              << " max=" << sharded.max_request << "\n";
+    std::cout << (mutex.requests == sharded.requests && mutex.bytes == sharded.bytes ? "Totals match.\n"
+                                                                                       : "Totals differ!\n");
+    return 0;
+}
@@ -3,9 +3,12 @@
  *     you may have in mind some more possible issues.
  */
 
+#include <atomic>
 #include <iostream>
 #include <mutex>
+#include <string>
 #include <thread>
+#include <utility>
 
 /**
  * Паттерн Одиночка
@@ -26,7 +29,7 @@ class Singleton
      * создание объекта через оператор new.
      */
 private:
-    static Singleton * pinstance_;
+    static std::atomic<Singleton *> pinstance_;
     static std::mutex mutex_;
 
 protected:
@@ -50,9 +53,14 @@ public:
      * первом запуске, он создаёт экземпляр одиночки и помещает его в
      * статическое поле. При последующих запусках, он возвращает клиенту объект,
      * хранящийся в статическом поле.
+     *
+     * Аргументы передаются конструктору как есть и нужны только при первом
+     * вызове. Если передать строковый литерал, временная std::string не
+     * создаётся, поэтому повторные вызовы ничего не выделяют в куче.
      */
 
-    static Singleton *GetInstance(const std::string& value);
+    template <typename... Args>
+    static Singleton *GetInstance(Args&&... args);
     /**
      * Наконец, любой одиночка должен содержать некоторую бизнес-логику, которая
      * может быть выполнена на его экземпляре.
@@ -62,7 +70,10 @@ public:
         // ...
     }
     
-    std::string value() const{
+    /**
+     * Возвращает ссылку, а не копию: чтение значения не выделяет память.
+     */
+    const std::string& value() const{
         return value_;
     } 
 };
@@ -71,27 +82,84 @@ public:
  * Static methods should be defined outside the class.
  */
 
-Singleton* Singleton::pinstance_{nullptr};
+std::atomic<Singleton *> Singleton::pinstance_{nullptr};
 std::mutex Singleton::mutex_;
 
 /**
  * The first time we call GetInstance we will lock the storage location
  *      and then we make sure again that the variable is null and then we
  *      set the value. RU:
+ *
+ * Быстрый путь читает указатель без блокировки, поэтому указатель атомарный.
+ * Загрузка с memory_order_acquire парна сохранению с memory_order_release:
+ * поток, увидевший ненулевой указатель, видит и полностью сконструированный
+ * объект. Под мьютексом достаточно relaxed-загрузки, порядок обеспечивает
+ * сам мьютекс.
  */
-Singleton *Singleton::GetInstance(const std::string& value)
+template <typename... Args>
+Singleton *Singleton::GetInstance(Args&&... args)
 {
-    if (pinstance_ == nullptr)
+    Singleton *instance = pinstance_.load(std::memory_order_acquire);
+    if (instance == nullptr)
     {
         std::lock_guard<std::mutex> lock(mutex_);
-        if (pinstance_ == nullptr)
+        instance = pinstance_.load(std::memory_order_relaxed);
+        if (instance == nullptr)
         {
-            pinstance_ = new Singleton(value);
+            instance = new Singleton(std::forward<Args>(args)...);
+            pinstance_.store(instance, std::memory_order_release);
         }
     }
-    return pinstance_;
+    return instance;
 }
 
+/**
+ * Тот же Одиночка на локальной статической переменной («Одиночка Майерса»).
+ * Начиная с C++11 компилятор сам гарантирует, что такая переменная
+ * инициализируется ровно один раз, даже если GetInstance вызывают из
+ * нескольких потоков одновременно. Ни мьютекса, ни атомарного указателя
+ * писать не нужно.
+ */
+class StaticSingleton
+{
+protected:
+    StaticSingleton(const std::string value): value_(value)
+    {
+    }
+    ~StaticSingleton() {}
+    std::string value_;
+
+public:
+    StaticSingleton(StaticSingleton &other) = delete;
+    void operator=(const StaticSingleton &) = delete;
+
+    /**
+     * Здесь GetInstance не может быть шаблоном, как у Singleton: каждая
+     * специализация шаблона получила бы свою статическую переменную, то есть
+     * свой экземпляр. Поэтому значение принимается как const char *, и
+     * std::string строится из него только при первом вызове.
+     */
+    static StaticSingleton *GetInstance(const char *value)
+    {
+        static StaticSingleton instance(value);
+        return &instance;
+    }
+
+    static StaticSingleton *GetInstance(const std::string& value)
+    {
+        return GetInstance(value.c_str());
+    }
+
+    void SomeBusinessLogic()
+    {
+        // ...
+    }
+
+    const std::string& value() const{
+        return value_;
+    }
+};
+
 void ThreadFoo(){
     // Этот код эмулирует медленную инициализацию.
     std::this_thread::sleep_for(std::chrono::milliseconds(1000));
@@ -106,6 +174,18 @@ void ThreadBar(){
     std::cout << singleton->value() << "\n";
 }
 
+void StaticThreadFoo(){
+    std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+    StaticSingleton* singleton = StaticSingleton::GetInstance("FOO");
+    std::cout << singleton->value() << "\n";
+}
+
+void StaticThreadBar(){
+    std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+    StaticSingleton* singleton = StaticSingleton::GetInstance("BAR");
+    std::cout << singleton->value() << "\n";
+}
+
 int main()
 {   
     std::cout <<"If you see the same value, then singleton was reused (yay!\n" <<
@@ -115,6 +195,12 @@ int main()
     std::thread t2(ThreadBar);
     t1.join();
     t2.join();
-    
+
+    std::cout << "\nFunction-local static:\n";
+    std::thread t3(StaticThreadFoo);
+    std::thread t4(StaticThreadBar);
+    t3.join();
+    t4.join();
+
     return 0;
 }
\ No newline at end of file